@@ -5,19 +5,35 @@
 #include <systemd/sd-event.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <optional>
 #include <string_view>
 #include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include "connection_cache.hh"
+#include "mirror.hh"
+#include "profiler.hh"
+#include "transcript.hh"
+
 namespace fs = std::filesystem;
 
 namespace aur {
 
+namespace {
+class ResponseHandler;
+}  // namespace
+
 class AurImpl : public Aur {
  public:
   explicit AurImpl(Options options = Options());
@@ -38,18 +54,88 @@ class AurImpl : public Aur {
   void QueueCloneRequest(const CloneRequest& request,
                          const CloneResponseCallback& callback) override;
 
+  void QueueVcsHeadRequest(const VcsHeadRequest& request,
+                           const VcsHeadResponseCallback& callback) override;
+
+  void WarmUp() override;
+
   // Wait for all pending requests to complete. Returns non-zero if any request
   // failed or was cancelled by a callback.
   int Wait() override;
 
+  int GetFd() override;
+  int Process() override;
+
  private:
   using ActiveRequests =
       std::unordered_set<std::variant<CURL*, sd_event_source*>>;
 
+  struct Subprocess {
+    std::vector<std::string> argv;
+    ResponseHandler* handler;
+    bool capture_stdout;
+    Priority priority;
+  };
+
+  struct HttpTransfer {
+    std::string url;
+    ResponseHandler* handler;
+    Priority priority;
+
+    // Only the headers are wanted, as the transfer is only made for the sake
+    // of its connection.
+    bool head_only = false;
+  };
+
+  // Pending work is queued separately for each Priority, indexed by its value.
+  template <typename T>
+  using PriorityQueues = std::array<T, static_cast<size_t>(Priority::BULK) + 1>;
+
+  // Returns how many of |limit| slots may be in use for work of |priority| to
+  // start. Anything below the top priority leaves a slot free for it, so that
+  // a burst of bulk work can't keep an urgent lookup waiting.
+  static int SlotsFor(Priority priority, int limit);
+
+  // Each URL of an HTTP request becomes a transfer, which is handed to curl
+  // once the number of transfers in flight and the size of their responses
+  // so far are both under the configured limits. Higher priority transfers
+  // are always started first.
   template <typename ResponseHandlerType>
   void QueueHttpRequest(
       const HttpRequest& request,
       const typename ResponseHandlerType::CallbackType& callback);
+  void StartHttpTransfer(HttpTransfer transfer);
+  void StartReplayedTransfer(ResponseHandler* handler);
+
+  // Delivers |handler|'s local_response after |delay|, as though it had come
+  // from curl.
+  void DeliverLocalResponse(ResponseHandler* handler,
+                            std::chrono::microseconds delay);
+  void StartPendingHttpTransfers();
+  size_t BufferedBytes() const;
+
+  // Subprocesses are started immediately if we're under the configured limit,
+  // and are otherwise held until a running subprocess exits. As with HTTP
+  // transfers, higher priority subprocesses are started first.
+  void QueueSubprocess(Subprocess subprocess);
+  void StartSubprocess(Subprocess subprocess);
+  void StartPendingSubprocesses();
+
+  // Connection state is loaded when we're created and saved when we're
+  // destroyed. In between, the address of each server we reach is noted.
+  void LoadConnectionCache();
+  void SaveConnectionCache();
+  void RememberAddress(CURL* curl, CURLcode result, const std::string& url);
+#if LIBCURL_VERSION_NUM >= 0x080c00
+  static CURLcode ExportTlsSession(CURL* curl, void* userdata,
+                                   const char* session_key,
+                                   const unsigned char* shmac,
+                                   size_t shmac_len,
+                                   const unsigned char* sdata,
+                                   size_t sdata_len, curl_off_t valid_until,
+                                   int ietf_tls_id, const char* alpn,
+                                   size_t earlydata_max);
+#endif
 
   int FinishRequest(CURL* curl, CURLcode result, bool dispatch_callback);
   int FinishRequest(sd_event_source* source);
@@ -79,14 +165,32 @@ class AurImpl : public Aur {
   static int OnCurlIO(sd_event_source* s, int fd, uint32_t revents,
                       void* userdata);
   static int OnCurlTimer(sd_event_source* s, uint64_t usec, void* userdata);
-  static int OnCloneExit(sd_event_source* s, const siginfo_t* si,
-                         void* userdata);
+  static int OnSubprocessExit(sd_event_source* s, const siginfo_t* si,
+                              void* userdata);
+  static int OnLocalResponse(sd_event_source* s, uint64_t usec,
+                             void* userdata);
 
   Options options_;
 
   CURLM* curl_multi_;
   ActiveRequests active_requests_;
 
+  // Shared by all transfers, so that DNS results and TLS sessions carry over
+  // from one connection to the next.
+  CURLSH* curl_share_;
+
+  std::optional<ConnectionCache> connection_cache_;
+  curl_slist* resolve_ = nullptr;
+
+  PriorityQueues<std::deque<Subprocess>> pending_subprocesses_;
+  int running_subprocesses_ = 0;
+
+  // Pending transfers are kept in one queue per request, and the queues are
+  // served round robin so that a request split into many URLs doesn't hold
+  // up the requests queued after it.
+  PriorityQueues<std::deque<std::deque<HttpTransfer>>> pending_http_transfers_;
+  int running_http_transfers_ = 0;
+
   sigset_t saved_ss_{};
   sd_event* event_ = nullptr;
   sd_event_source* timer_ = nullptr;
@@ -94,10 +198,26 @@ class AurImpl : public Aur {
 
   DebugLevel debug_level_ = DebugLevel::NONE;
   std::ofstream debug_stream_;
+
+  // When recording, every completed HTTP exchange is written to |recorder_|.
+  // When replaying, HTTP requests never reach curl, and are instead answered
+  // from |replay_| after their recorded latency, multiplied by
+  // |replay_latency_scale_|.
+  TranscriptWriter recorder_;
+  std::optional<Transcript> replay_;
+  double replay_latency_scale_ = 1.0;
+
+  // Set when the base URL is a file:// URL, in which case HTTP requests are
+  // answered from the local filesystem.
+  std::optional<LocalMirror> mirror_;
 };
 
 namespace {
 
+// curl doesn't tell us the TTL of the DNS records it looked up, so resolved
+// addresses are trusted for a fixed, short time.
+constexpr std::chrono::minutes kAddressTtl(10);
+
 std::string_view GetEnv(const char* name) {
   auto* value = getenv(name);
   return std::string_view(value ? value : "");
@@ -121,7 +241,11 @@ bool ConsumePrefix(std::string_view* view, std::string_view prefix) {
 class ResponseHandler {
  public:
   explicit ResponseHandler(AurImpl* aur) : aur_(aur) {}
-  virtual ~ResponseHandler() = default;
+  virtual ~ResponseHandler() {
+    if (output_fd >= 0) {
+      close(output_fd);
+    }
+  }
 
   ResponseHandler(const ResponseHandler&) = delete;
   ResponseHandler& operator=(const ResponseHandler&) = delete;
@@ -160,6 +284,23 @@ class ResponseHandler {
   std::string body;
   std::array<char, CURL_ERROR_SIZE> error_buffer = {};
 
+  // For requests serviced by a subprocess: the program being run, and the file
+  // capturing its stdout (if any).
+  std::string program;
+  int output_fd = -1;
+
+  // For HTTP requests: the URL being fetched, and when the transfer started.
+  std::string url;
+  std::chrono::steady_clock::time_point started_at;
+
+  // Whether the exchange belongs in a transcript. Only requests made on
+  // behalf of the command do, so that replaying one makes exactly those.
+  bool recorded = true;
+
+  // For HTTP requests answered without curl, either from a transcript or a
+  // local mirror: the response to deliver.
+  Exchange local_response;
+
  private:
   virtual int Run(long status, const std::string& error) = 0;
 
@@ -178,10 +319,15 @@ class TypedResponseHandler : public ResponseHandler {
   virtual ResponseT MakeResponse() { return ResponseT(std::move(body)); }
 
   int Run(long status, const std::string& error) override {
-    return callback_(ResponseWrapper(MakeResponse(), status, error));
+    return callback_(ResponseWrapper(Decode(), status, error));
   }
 
  private:
+  ResponseT Decode() {
+    Profiler::Scope scope(Profiler::Phase::DECODE);
+    return MakeResponse();
+  }
+
   const CallbackType callback_;
 };
 
@@ -220,9 +366,15 @@ class CloneResponseHandler : public TypedResponseHandler<CloneResponse> {
   std::string operation_;
 };
 
+using VcsHeadResponseHandler = TypedResponseHandler<VcsHeadResponse>;
+
 }  // namespace
 
 AurImpl::AurImpl(Options options) : options_(std::move(options)) {
+  if (LocalMirror::IsLocal(options_.baseurl)) {
+    mirror_.emplace(options_.baseurl);
+  }
+
   curl_global_init(CURL_GLOBAL_SSL);
   curl_multi_ = curl_multi_init();
 
@@ -237,6 +389,14 @@ AurImpl::AurImpl(Options options) : options_(std::move(options)) {
                     &AurImpl::TimerCallback);
   curl_multi_setopt(curl_multi_, CURLMOPT_TIMERDATA, this);
 
+  curl_share_ = curl_share_init();
+  curl_share_setopt(curl_share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(curl_share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+  if (!options_.cache_dir.empty()) {
+    LoadConnectionCache();
+  }
+
   sigset_t ss{};
   sigaddset(&ss, SIGCHLD);
   sigprocmask(SIG_BLOCK, &ss, &saved_ss_);
@@ -250,10 +410,38 @@ AurImpl::AurImpl(Options options) : options_(std::move(options)) {
   } else if (!debug.empty()) {
     debug_level_ = DebugLevel::VERBOSE_STDERR;
   }
+
+  if (auto path = GetEnv("AURACLE_RECORD"); !path.empty()) {
+    if (!recorder_.Open(std::string(path))) {
+      std::cerr << "warning: failed to open " << path
+                << " for recording: " << strerror(errno) << "\n";
+    }
+  }
+
+  if (auto path = GetEnv("AURACLE_REPLAY"); !path.empty()) {
+    std::string error;
+    replay_ = Transcript::Load(std::string(path), &error);
+    if (!replay_) {
+      // Carry on with nothing to replay, so that every request fails rather
+      // than quietly going out to the network.
+      std::cerr << "error: " << error << "\n";
+      replay_.emplace();
+    }
+
+    if (auto scale = GetEnv("AURACLE_REPLAY_LATENCY_SCALE"); !scale.empty()) {
+      replay_latency_scale_ = std::max(0.0, strtod(scale.data(), nullptr));
+    }
+  }
 }
 
 AurImpl::~AurImpl() {
+  if (connection_cache_) {
+    SaveConnectionCache();
+  }
+
   curl_multi_cleanup(curl_multi_);
+  curl_share_cleanup(curl_share_);
+  curl_slist_free_all(resolve_);
   curl_global_cleanup();
 
   sd_event_source_unref(timer_);
@@ -266,6 +454,105 @@ AurImpl::~AurImpl() {
   }
 }
 
+void AurImpl::LoadConnectionCache() {
+  connection_cache_.emplace(kAddressTtl);
+  connection_cache_->Load(fs::path(options_.cache_dir) / "connections");
+
+  const auto now = ConnectionCache::Clock::now();
+  for (const auto& address : connection_cache_->Addresses(now)) {
+    resolve_ = curl_slist_append(resolve_, address.c_str());
+  }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+  // Sessions can only be imported through a handle, which puts them in the
+  // cache of the share it uses.
+  auto* curl = curl_easy_init();
+  curl_easy_setopt(curl, CURLOPT_SHARE, curl_share_);
+  for (const auto& session : connection_cache_->Sessions(now)) {
+    curl_easy_ssls_import(
+        curl, session.key.c_str(),
+        reinterpret_cast<const unsigned char*>(session.shmac.data()),
+        session.shmac.size(),
+        reinterpret_cast<const unsigned char*>(session.data.data()),
+        session.data.size());
+  }
+  curl_easy_cleanup(curl);
+#endif
+}
+
+void AurImpl::SaveConnectionCache() {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+  auto* curl = curl_easy_init();
+  curl_easy_setopt(curl, CURLOPT_SHARE, curl_share_);
+  curl_easy_ssls_export(curl, &AurImpl::ExportTlsSession, this);
+  curl_easy_cleanup(curl);
+#endif
+
+  // This is only ever an optimization, so failing to save isn't worth
+  // bothering anyone about.
+  connection_cache_->Save(fs::path(options_.cache_dir) / "connections",
+                          ConnectionCache::Clock::now());
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+// static
+CURLcode AurImpl::ExportTlsSession(CURL*, void* userdata,
+                                   const char* session_key,
+                                   const unsigned char* shmac,
+                                   size_t shmac_len,
+                                   const unsigned char* sdata,
+                                   size_t sdata_len, curl_off_t valid_until,
+                                   int, const char*, size_t) {
+  auto* aur = static_cast<AurImpl*>(userdata);
+
+  ConnectionCache::TlsSession session;
+  session.key = session_key;
+  session.shmac.assign(reinterpret_cast<const char*>(shmac), shmac_len);
+  session.data.assign(reinterpret_cast<const char*>(sdata), sdata_len);
+  session.valid_until =
+      ConnectionCache::Clock::time_point(std::chrono::seconds(valid_until));
+  aur->connection_cache_->StoreSession(std::move(session));
+
+  return CURLE_OK;
+}
+#endif
+
+void AurImpl::RememberAddress(CURL* curl, CURLcode result,
+                              const std::string& url) {
+  CURLU* parsed = curl_url();
+  char* host = nullptr;
+  char* port = nullptr;
+  if (curl_url_set(parsed, CURLUPART_URL, url.c_str(), 0) == CURLUE_OK &&
+      curl_url_get(parsed, CURLUPART_HOST, &host, 0) == CURLUE_OK &&
+      curl_url_get(parsed, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) ==
+          CURLUE_OK &&
+      host[0] != '[') {
+    switch (result) {
+      case CURLE_OK: {
+        char* address = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &address);
+
+        // Nothing was looked up for a literal address, or a Unix socket.
+        if (address != nullptr && strcmp(address, host) != 0) {
+          connection_cache_->StoreAddress(host, atol(port), address,
+                                          ConnectionCache::Clock::now());
+        }
+        break;
+      }
+      case CURLE_COULDNT_CONNECT:
+      case CURLE_OPERATION_TIMEDOUT:
+        connection_cache_->ForgetAddress(host, atol(port));
+        break;
+      default:
+        break;
+    }
+  }
+
+  curl_free(host);
+  curl_free(port);
+  curl_url_cleanup(parsed);
+}
+
 void AurImpl::Cancel(const ActiveRequests::value_type& request) {
   struct Visitor {
     constexpr explicit Visitor(AurImpl* aur) : aur(aur) {}
@@ -288,6 +575,24 @@ void AurImpl::CancelAll() {
     Cancel(*active_requests_.begin());
   }
 
+  for (auto& subprocesses : pending_subprocesses_) {
+    for (const auto& subprocess : subprocesses) {
+      delete subprocess.handler;
+    }
+    subprocesses.clear();
+  }
+  running_subprocesses_ = 0;
+
+  for (auto& queues : pending_http_transfers_) {
+    for (const auto& queue : queues) {
+      for (const auto& transfer : queue) {
+        delete transfer.handler;
+      }
+    }
+    queues.clear();
+  }
+  running_http_transfers_ = 0;
+
   cancelled_ = true;
 }
 
@@ -418,29 +723,41 @@ int AurImpl::FinishRequest(CURL* curl, CURLcode result,
   ResponseHandler* handler;
   curl_easy_getinfo(curl, CURLINFO_PRIVATE, &handler);
 
-  int r = 0;
-  if (dispatch_callback) {
-    long response_code;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+  long response_code = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
 
-    std::string error;
-    if (result != CURLE_OK) {
-      error = handler->error_buffer.data();
-      if (error.empty()) {
-        error = curl_easy_strerror(result);
-      }
-    }
-
-    r = handler->RunCallback(response_code, error);
-  } else {
-    delete handler;
+  if (connection_cache_ && dispatch_callback) {
+    RememberAddress(curl, result, handler->url);
   }
 
+  // Retire the transfer before running the callback, which may well queue
+  // more transfers and expects to find the window as it now stands.
   active_requests_.erase(curl);
   curl_multi_remove_handle(curl_multi_, curl);
   curl_easy_cleanup(curl);
+  running_http_transfers_--;
+
+  if (!dispatch_callback) {
+    delete handler;
+    return 0;
+  }
+
+  std::string error;
+  if (result != CURLE_OK) {
+    error = handler->error_buffer.data();
+    if (error.empty()) {
+      error = curl_easy_strerror(result);
+    }
+  }
+
+  if (recorder_.is_open() && handler->recorded) {
+    recorder_.Write({handler->url, response_code, error, handler->body,
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() -
+                         handler->started_at)});
+  }
 
-  return r;
+  return handler->RunCallback(response_code, error);
 }
 
 int AurImpl::FinishRequest(sd_event_source* source) {
@@ -452,21 +769,29 @@ int AurImpl::FinishRequest(sd_event_source* source) {
 int AurImpl::CheckFinished() {
   int unused;
 
-  auto* msg = curl_multi_info_read(curl_multi_, &unused);
-  if (msg == nullptr || msg->msg != CURLMSG_DONE) {
-    return 0;
-  }
+  // Several transfers may finish at once. Any that we left unread here would
+  // still hold their slots in the window.
+  while (auto* msg = curl_multi_info_read(curl_multi_, &unused)) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
 
-  auto r = FinishRequest(msg->easy_handle, msg->data.result,
-                         /* dispatch_callback = */ true);
-  if (r < 0) {
-    CancelAll();
+    auto r = FinishRequest(msg->easy_handle, msg->data.result,
+                           /* dispatch_callback = */ true);
+    if (r < 0) {
+      CancelAll();
+      return r;
+    }
   }
 
-  return r;
+  StartPendingHttpTransfers();
+
+  return 0;
 }
 
 int AurImpl::Wait() {
+  Profiler::Scope scope(Profiler::Phase::NETWORK_WAIT);
+
   cancelled_ = false;
 
   while (!active_requests_.empty()) {
@@ -478,98 +803,347 @@ int AurImpl::Wait() {
   return cancelled_ ? -ECANCELED : 0;
 }
 
+void AurImpl::WarmUp() {
+  // The handshake is what's worth hiding, and there's none to speak of for
+  // anything but HTTPS. Transcripts and local mirrors need no connection.
+  if (options_.baseurl.compare(0, 8, "https://") != 0 || replay_ || mirror_) {
+    return;
+  }
+
+  auto* handler = new RawResponseHandler(
+      this, [](ResponseWrapper<RawResponse>) { return 0; });
+  handler->recorded = false;
+
+  // Any path will do to bring up the connection. Stay clear of the RPC, whose
+  // requests count against a daily per-address limit.
+  std::deque<HttpTransfer> transfer;
+  transfer.push_back({options_.baseurl + "/", handler,
+                      Priority::RESOLUTION, /* head_only = */ true});
+
+  pending_http_transfers_[static_cast<size_t>(Priority::RESOLUTION)].push_back(
+      std::move(transfer));
+  StartPendingHttpTransfers();
+
+  // Nothing would happen until the event loop next runs, which is likely not
+  // until the first real request is waited on. Kick curl now, so that the
+  // lookup (or with a cached address, the TCP handshake) proceeds meanwhile.
+  int unused;
+  curl_multi_socket_action(curl_multi_, CURL_SOCKET_TIMEOUT, 0, &unused);
+}
+
+int AurImpl::GetFd() { return sd_event_get_fd(event_); }
+
+int AurImpl::Process() {
+  // Each iteration of the loop also arms the timers that the descriptor waits
+  // on, which is why callers need to come here once before they first poll.
+  if (sd_event_run(event_, 0) < 0) {
+    return -EIO;
+  }
+
+  if (!active_requests_.empty()) {
+    return 1;
+  }
+
+  // There's no call to mark the start of a batch of requests, so a
+  // cancellation is forgotten once it has been reported.
+  const bool cancelled = std::exchange(cancelled_, false);
+  return cancelled ? -ECANCELED : 0;
+}
+
 template <typename ResponseHandlerType>
 void AurImpl::QueueHttpRequest(
     const HttpRequest& request,
     const typename ResponseHandlerType::CallbackType& callback) {
-  for (const auto& r : request.Build(options_.baseurl)) {
-    auto* curl = curl_easy_init();
-    auto* handler = new ResponseHandlerType(this, callback);
-
-    using RH = ResponseHandler;
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2);
-    curl_easy_setopt(curl, CURLOPT_URL, r.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &RH::BodyCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, handler);
-    curl_easy_setopt(curl, CURLOPT_PRIVATE, handler);
-    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, handler->error_buffer.data());
-    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, options_.useragent.c_str());
-
-    switch (debug_level_) {
-      case DebugLevel::NONE:
-        break;
-      case DebugLevel::REQUESTS:
-        curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, &RH::DebugCallback);
-        curl_easy_setopt(curl, CURLOPT_DEBUGDATA, &debug_stream_);
-        [[fallthrough]];
-      case DebugLevel::VERBOSE_STDERR:
-        curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-        break;
+  std::deque<HttpTransfer> transfers;
+  for (auto& url : request.Build(options_.baseurl)) {
+    transfers.push_back({std::move(url),
+                         new ResponseHandlerType(this, callback),
+                         request.priority()});
+  }
+
+  if (!transfers.empty()) {
+    auto& queues =
+        pending_http_transfers_[static_cast<size_t>(request.priority())];
+    queues.push_back(std::move(transfers));
+    StartPendingHttpTransfers();
+  }
+}
+
+// static
+int AurImpl::SlotsFor(Priority priority, int limit) {
+  if (priority == Priority::RESOLUTION || limit <= 1) {
+    return limit;
+  }
+
+  return limit - 1;
+}
+
+size_t AurImpl::BufferedBytes() const {
+  size_t bytes = 0;
+  for (const auto& request : active_requests_) {
+    if (const auto* curl = std::get_if<CURL*>(&request)) {
+      ResponseHandler* handler;
+      curl_easy_getinfo(*curl, CURLINFO_PRIVATE, &handler);
+      bytes += handler->body.size();
+    }
+  }
+  return bytes;
+}
+
+void AurImpl::StartPendingHttpTransfers() {
+  for (;;) {
+    auto queues = std::find_if(pending_http_transfers_.begin(),
+                               pending_http_transfers_.end(),
+                               [](const auto& q) { return !q.empty(); });
+    if (queues == pending_http_transfers_.end()) {
+      break;
     }
 
-    curl_multi_add_handle(curl_multi_, curl);
-    active_requests_.emplace(curl);
+    const auto priority = queues->front().front().priority;
+    if (running_http_transfers_ >=
+        SlotsFor(priority, options_.max_http_requests)) {
+      break;
+    }
+
+    // Always let one transfer run, or a single response larger than the limit
+    // would stall everything behind it. Resolution lookups are small, and
+    // aren't made to wait for bulk responses to drain.
+    if (priority != Priority::RESOLUTION && running_http_transfers_ > 0 &&
+        BufferedBytes() >= options_.max_buffered_bytes) {
+      break;
+    }
+
+    auto& queue = queues->front();
+    auto transfer = std::move(queue.front());
+    queue.pop_front();
+
+    if (!queue.empty()) {
+      queues->push_back(std::move(queue));
+    }
+    queues->pop_front();
+
+    StartHttpTransfer(std::move(transfer));
   }
 }
 
+void AurImpl::StartHttpTransfer(HttpTransfer transfer) {
+  auto* handler = transfer.handler;
+  handler->url = std::move(transfer.url);
+  handler->started_at = std::chrono::steady_clock::now();
+
+  if (replay_) {
+    StartReplayedTransfer(handler);
+    return;
+  }
+
+  if (mirror_) {
+    handler->local_response = mirror_->Fetch(handler->url);
+    DeliverLocalResponse(handler, std::chrono::microseconds(0));
+    return;
+  }
+
+  auto* curl = curl_easy_init();
+
+  using RH = ResponseHandler;
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2);
+  curl_easy_setopt(curl, CURLOPT_URL, handler->url.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &RH::BodyCallback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, handler);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, handler);
+  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, handler->error_buffer.data());
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, options_.useragent.c_str());
+  curl_easy_setopt(curl, CURLOPT_SHARE, curl_share_);
+  curl_easy_setopt(curl, CURLOPT_NOBODY, transfer.head_only ? 1L : 0L);
+
+  // Rather than open a connection of its own, wait to see if one that's still
+  // being set up, such as the warm-up's, can be multiplexed.
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  if (resolve_ != nullptr) {
+    curl_easy_setopt(curl, CURLOPT_RESOLVE, resolve_);
+  }
+  if (!options_.unix_socket_path.empty()) {
+    curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH,
+                     options_.unix_socket_path.c_str());
+  }
+
+  // Transfers share multiplexed connections, so also ask the server to favor
+  // the more urgent streams.
+  switch (transfer.priority) {
+    case Priority::RESOLUTION:
+      curl_easy_setopt(curl, CURLOPT_STREAM_WEIGHT, 256L);
+      break;
+    case Priority::METADATA:
+      curl_easy_setopt(curl, CURLOPT_STREAM_WEIGHT, 64L);
+      break;
+    case Priority::BULK:
+      curl_easy_setopt(curl, CURLOPT_STREAM_WEIGHT, 16L);
+      break;
+  }
+
+  switch (debug_level_) {
+    case DebugLevel::NONE:
+      break;
+    case DebugLevel::REQUESTS:
+      curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, &RH::DebugCallback);
+      curl_easy_setopt(curl, CURLOPT_DEBUGDATA, &debug_stream_);
+      [[fallthrough]];
+    case DebugLevel::VERBOSE_STDERR:
+      curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+      break;
+  }
+
+  curl_multi_add_handle(curl_multi_, curl);
+  active_requests_.emplace(curl);
+  running_http_transfers_++;
+}
+
+void AurImpl::StartReplayedTransfer(ResponseHandler* handler) {
+  if (auto exchange = replay_->Take(handler->url)) {
+    handler->local_response = std::move(*exchange);
+  } else {
+    handler->local_response.error = "no recorded response for " + handler->url;
+  }
+
+  DeliverLocalResponse(
+      handler, std::chrono::duration_cast<std::chrono::microseconds>(
+                   handler->local_response.latency * replay_latency_scale_));
+}
+
+void AurImpl::DeliverLocalResponse(ResponseHandler* handler,
+                                   std::chrono::microseconds delay) {
+  // Even an immediate response goes through the event loop, so that callbacks
+  // never run from inside the call which queued their request.
+  sd_event_source* source;
+  sd_event_add_time(event_, &source, CLOCK_MONOTONIC,
+                    ToUnixMicros(handler->started_at + delay), 0,
+                    &AurImpl::OnLocalResponse, handler);
+
+  active_requests_.emplace(source);
+  running_http_transfers_++;
+}
+
 // static
-int AurImpl::OnCloneExit(sd_event_source* source, const siginfo_t* si,
-                         void* userdata) {
-  auto* handler = static_cast<CloneResponseHandler*>(userdata);
+int AurImpl::OnLocalResponse(sd_event_source* source, uint64_t,
+                             void* userdata) {
+  auto* handler = static_cast<ResponseHandler*>(userdata);
+  auto* aur = handler->aur();
+
+  aur->FinishRequest(source);
+  aur->running_http_transfers_--;
+
+  handler->body = std::move(handler->local_response.body);
+  const long status = handler->local_response.status;
+  const std::string error = std::move(handler->local_response.error);
+
+  auto r = handler->RunCallback(status, error);
+  if (r < 0) {
+    aur->CancelAll();
+    return r;
+  }
 
-  handler->aur()->FinishRequest(source);
+  aur->StartPendingHttpTransfers();
+
+  return 0;
+}
+
+// static
+int AurImpl::OnSubprocessExit(sd_event_source* source, const siginfo_t* si,
+                              void* userdata) {
+  auto* handler = static_cast<ResponseHandler*>(userdata);
+  auto* aur = handler->aur();
+
+  aur->FinishRequest(source);
+  aur->running_subprocesses_--;
+  aur->StartPendingSubprocesses();
 
   std::string error;
-  if (si->si_status != 0) {
-    error.assign("git exited with unexpected exit status " +
+  if (si->si_code != CLD_EXITED) {
+    error.assign(handler->program + " was terminated by signal " +
+                 std::to_string(si->si_status));
+  } else if (si->si_status != 0) {
+    error.assign(handler->program + " exited with unexpected exit status " +
                  std::to_string(si->si_status));
   }
 
+  if (handler->output_fd >= 0 && lseek(handler->output_fd, 0, SEEK_SET) == 0) {
+    std::array<char, BUFSIZ> buf;
+    for (;;) {
+      ssize_t n = read(handler->output_fd, buf.data(), buf.size());
+      if (n <= 0) {
+        break;
+      }
+      handler->body.append(buf.data(), n);
+    }
+  }
+
   return handler->RunCallback(si->si_status, error);
 }
 
-void AurImpl::QueueCloneRequest(const CloneRequest& request,
-                                const CloneResponseCallback& callback) {
-  const bool update = fs::exists(fs::path(request.reponame()) / ".git");
+void AurImpl::QueueSubprocess(Subprocess subprocess) {
+  pending_subprocesses_[static_cast<size_t>(subprocess.priority)].push_back(
+      std::move(subprocess));
+  StartPendingSubprocesses();
+}
 
-  auto* handler =
-      new CloneResponseHandler(this, callback, update ? "update" : "clone");
+void AurImpl::StartPendingSubprocesses() {
+  for (;;) {
+    auto queue = std::find_if(pending_subprocesses_.begin(),
+                              pending_subprocesses_.end(),
+                              [](const auto& q) { return !q.empty(); });
+    if (queue == pending_subprocesses_.end() ||
+        running_subprocesses_ >= SlotsFor(queue->front().priority,
+                                          options_.max_subprocesses)) {
+      break;
+    }
+
+    auto subprocess = std::move(queue->front());
+    queue->pop_front();
+
+    StartSubprocess(std::move(subprocess));
+  }
+}
+
+void AurImpl::StartSubprocess(Subprocess subprocess) {
+  auto* handler = subprocess.handler;
+  handler->program = subprocess.argv[0];
+
+  if (subprocess.capture_stdout) {
+    FILE* output = tmpfile();
+    if (output == nullptr) {
+      handler->RunCallback(-errno, "failed to create output file for " +
+                                       handler->program + ": " +
+                                       std::string(strerror(errno)));
+      return;
+    }
+
+    handler->output_fd = dup(fileno(output));
+    fclose(output);
+  }
 
   int pid = fork();
   if (pid < 0) {
-    handler->RunCallback(-errno, "failed to fork new process for git: " +
+    handler->RunCallback(-errno, "failed to fork new process for " +
+                                     handler->program + ": " +
                                      std::string(strerror(errno)));
     return;
   }
 
   if (pid == 0) {
-    const auto url = request.Build(options_.baseurl)[0];
+    if (handler->output_fd >= 0) {
+      dup2(handler->output_fd, STDOUT_FILENO);
+    }
+
+    // Never block on a credential prompt for a repository we can't read, and
+    // never allow transports like ext:: which run arbitrary commands.
+    setenv("GIT_TERMINAL_PROMPT", "0", 1);
+    setenv("GIT_PROTOCOL_FROM_USER", "0", 1);
 
     std::vector<const char*> cmd;
-    if (update) {
-      // clang-format off
-      cmd = {
-        "git",
-         "-C",
-        request.reponame().c_str(),
-        "pull",
-         "--quiet",
-         "--rebase",
-         "--autostash",
-         "--ff-only",
-      };
-      // clang-format on
-    } else {
-      // clang-format off
-      cmd = {
-        "git",
-        "clone",
-        "--quiet",
-        url.c_str(),
-      };
-      // clang-format on
+    cmd.reserve(subprocess.argv.size() + 1);
+    for (const auto& arg : subprocess.argv) {
+      cmd.push_back(arg.c_str());
     }
     cmd.push_back(nullptr);
 
@@ -578,12 +1152,56 @@ void AurImpl::QueueCloneRequest(const CloneRequest& request,
   }
 
   sd_event_source* child;
-  sd_event_add_child(event_, &child, pid, WEXITED, &AurImpl::OnCloneExit,
+  sd_event_add_child(event_, &child, pid, WEXITED, &AurImpl::OnSubprocessExit,
                      handler);
 
+  running_subprocesses_++;
   active_requests_.emplace(child);
 }
 
+void AurImpl::QueueCloneRequest(const CloneRequest& request,
+                                const CloneResponseCallback& callback) {
+  const bool update = fs::exists(fs::path(request.reponame()) / ".git");
+
+  auto* handler =
+      new CloneResponseHandler(this, callback, update ? "update" : "clone");
+
+  std::vector<std::string> argv;
+  if (update) {
+    // clang-format off
+    argv = {
+      "git",
+      "-C",
+      request.reponame(),
+      "pull",
+      "--quiet",
+      "--rebase",
+      "--autostash",
+      "--ff-only",
+    };
+    // clang-format on
+  } else {
+    // clang-format off
+    argv = {
+      "git",
+      "clone",
+      "--quiet",
+      request.Build(options_.baseurl)[0],
+    };
+    // clang-format on
+  }
+
+  QueueSubprocess({std::move(argv), handler, /* capture_stdout = */ false,
+                   request.priority()});
+}
+
+void AurImpl::QueueVcsHeadRequest(const VcsHeadRequest& request,
+                                  const VcsHeadResponseCallback& callback) {
+  QueueSubprocess({request.Build(options_.baseurl),
+                   new VcsHeadResponseHandler(this, callback),
+                   /* capture_stdout = */ true, request.priority()});
+}
+
 void AurImpl::QueueRawRequest(const HttpRequest& request,
                               const RawResponseCallback& callback) {
   QueueHttpRequest<RawResponseHandler>(request, callback);
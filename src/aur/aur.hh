@@ -18,6 +18,7 @@ class Aur {
   using RpcResponseCallback = ResponseCallback<RpcResponse>;
   using RawResponseCallback = ResponseCallback<RawResponse>;
   using CloneResponseCallback = ResponseCallback<CloneResponse>;
+  using VcsHeadResponseCallback = ResponseCallback<VcsHeadResponse>;
 
   struct Options {
     Options() = default;
@@ -28,6 +29,8 @@ class Aur {
     Options(Options&&) = default;
     Options& operator=(Options&&) = default;
 
+    // A file:// URL names a local mirror of the AUR, from which requests are
+    // answered without any network access. See mirror.hh for its layout.
     Options& set_baseurl(std::string baseurl) {
       this->baseurl = std::move(baseurl);
       return *this;
@@ -39,6 +42,47 @@ class Aur {
       return *this;
     }
     std::string useragent;
+
+    // If set, HTTP requests are sent over this Unix domain socket rather than
+    // a TCP connection to the host in |baseurl|, which still names the host
+    // in each request.
+    Options& set_unix_socket_path(std::string unix_socket_path) {
+      this->unix_socket_path = std::move(unix_socket_path);
+      return *this;
+    }
+    std::string unix_socket_path;
+
+    // If set, the addresses that servers resolve to and the TLS sessions
+    // they hand out are kept in this directory, so that later runs can skip
+    // the DNS lookup and resume the session rather than repeat the handshake.
+    Options& set_cache_dir(std::string cache_dir) {
+      this->cache_dir = std::move(cache_dir);
+      return *this;
+    }
+    std::string cache_dir;
+
+    Options& set_max_subprocesses(int max_subprocesses) {
+      this->max_subprocesses = max_subprocesses;
+      return *this;
+    }
+    int max_subprocesses = 8;
+
+    // HTTP requests, including each part of a request that's split across
+    // several URLs, are handed to curl only while fewer than this many are in
+    // flight.
+    Options& set_max_http_requests(int max_http_requests) {
+      this->max_http_requests = max_http_requests;
+      return *this;
+    }
+    int max_http_requests = 16;
+
+    // No further HTTP requests are started while the responses in flight
+    // have buffered at least this many bytes between them.
+    Options& set_max_buffered_bytes(size_t max_buffered_bytes) {
+      this->max_buffered_bytes = max_buffered_bytes;
+      return *this;
+    }
+    size_t max_buffered_bytes = 32 << 20;
   };
 
   Aur() = default;
@@ -64,9 +108,31 @@ class Aur {
   virtual void QueueCloneRequest(const CloneRequest& request,
                                  const CloneResponseCallback& callback) = 0;
 
+  // Query the head of an upstream VCS repository.
+  virtual void QueueVcsHeadRequest(const VcsHeadRequest& request,
+                                   const VcsHeadResponseCallback& callback) = 0;
+
+  // Starts connecting to the AUR before there's anything to ask it, so that the
+  // connection is ready, or at least on its way, by the time the first
+  // request is queued. Nothing is reported back, and Wait() doesn't fail if
+  // the connection can't be made. The warm-up is never recorded into a
+  // transcript, since the command didn't ask for it.
+  virtual void WarmUp() = 0;
+
   // Wait for all pending requests to complete. Returns non-zero if any request
   // failed or was cancelled by a callback.
   virtual int Wait() = 0;
+
+  // As an alternative to Wait(), requests can be driven from an event loop
+  // owned by the caller. GetFd() returns a file descriptor which becomes
+  // readable whenever there's work to be done. Call Process() once after
+  // queueing requests, and again each time the descriptor polls readable.
+  virtual int GetFd() = 0;
+
+  // Does whatever work is ready without blocking. Returns a positive number
+  // while requests remain outstanding. Once all requests have completed,
+  // returns as Wait() would.
+  virtual int Process() = 0;
 };
 
 std::unique_ptr<Aur> NewAur(Aur::Options options = Aur::Options());
@@ -0,0 +1,91 @@
+#include "aur.hh"
+
+#include <poll.h>
+#include <stdlib.h>
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace fs = std::filesystem;
+
+using testing::ElementsAre;
+
+namespace {
+
+// Requests are answered from a local mirror, which goes through the same
+// event loop as the network without needing one.
+class AurTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_NE(mkdtemp(root_), nullptr);
+
+    const auto path = fs::path(root_) / "info" / "auracle-git.json";
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << R"({"Name":"auracle-git"})";
+
+    aur_ = aur::NewAur(
+        aur::Aur::Options().set_baseurl(std::string("file://") + root_));
+  }
+
+  void TearDown() override { fs::remove_all(root_); }
+
+  // Runs the event loop as a caller with its own would: poll the descriptor,
+  // and call Process() whenever it's readable. Wait() is never called.
+  int DriveToCompletion() {
+    const int fd = aur_->GetFd();
+    EXPECT_GE(fd, 0);
+
+    int r;
+    while ((r = aur_->Process()) > 0) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 5000) <= 0) {
+        ADD_FAILURE() << "timed out waiting for the descriptor";
+        return -ETIMEDOUT;
+      }
+    }
+
+    return r;
+  }
+
+  char root_[24] = "/tmp/aur_test.XXXXXX";
+  std::unique_ptr<aur::Aur> aur_;
+};
+
+TEST_F(AurTest, ProcessCompletesRequestsWithoutWait) {
+  std::vector<std::string> names;
+
+  aur::InfoRequest request;
+  request.AddArg("auracle-git");
+  aur_->QueueRpcRequest(
+      request, [&names](aur::ResponseWrapper<aur::RpcResponse> response) {
+        EXPECT_TRUE(response.ok());
+        for (const auto& p : response.value().results) {
+          names.push_back(p.name);
+        }
+        return 0;
+      });
+
+  EXPECT_EQ(DriveToCompletion(), 0);
+  EXPECT_THAT(names, ElementsAre("auracle-git"));
+}
+
+TEST_F(AurTest, ProcessReportsCancellationOnce) {
+  aur::InfoRequest request;
+  request.AddArg("auracle-git");
+  aur_->QueueRpcRequest(request, [](aur::ResponseWrapper<aur::RpcResponse>) {
+    return -EIO;
+  });
+
+  EXPECT_EQ(DriveToCompletion(), -ECANCELED);
+
+  // With nothing outstanding, the next call has nothing left to report.
+  EXPECT_EQ(aur_->Process(), 0);
+}
+
+}  // namespace
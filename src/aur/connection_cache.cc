@@ -0,0 +1,238 @@
+#include "connection_cache.hh"
+
+#include <cstdint>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace aur {
+
+namespace {
+
+// Each line of the file is one of:
+//
+//   address <TAB> expires <TAB> host:port <TAB> address
+//   session <TAB> valid_until <TAB> key <TAB> hex(shmac) <TAB> hex(data)
+//
+// Times are in seconds since the epoch.
+constexpr std::string_view kAddress = "address";
+constexpr std::string_view kSession = "session";
+
+std::vector<std::string_view> Split(std::string_view str, char delim) {
+  std::vector<std::string_view> fields;
+
+  for (;;) {
+    const auto pos = str.find(delim);
+    fields.push_back(str.substr(0, pos));
+    if (pos == str.npos) {
+      break;
+    }
+    str.remove_prefix(pos + 1);
+  }
+
+  return fields;
+}
+
+bool IsField(std::string_view str) {
+  return str.find_first_of("\t\n") == str.npos;
+}
+
+// Also rules out anything too long to be a time we'd have written.
+bool IsDigits(std::string_view str) {
+  return !str.empty() && str.size() <= 18 &&
+         str.find_first_not_of("0123456789") == str.npos;
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+std::string HexEncode(std::string_view bytes) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+
+  std::string hex;
+  hex.reserve(bytes.size() * 2);
+  for (unsigned char c : bytes) {
+    hex.push_back(kDigits[c >> 4]);
+    hex.push_back(kDigits[c & 0xf]);
+  }
+  return hex;
+}
+
+bool HexDecode(std::string_view hex, std::string* bytes) {
+  if (hex.size() % 2 != 0) {
+    return false;
+  }
+
+  bytes->clear();
+  bytes->reserve(hex.size() / 2);
+  for (size_t i = 0; i < hex.size(); i += 2) {
+    const int hi = HexValue(hex[i]);
+    const int lo = HexValue(hex[i + 1]);
+    if (hi < 0 || lo < 0) {
+      return false;
+    }
+    bytes->push_back(static_cast<char>(hi << 4 | lo));
+  }
+  return true;
+}
+
+ConnectionCache::Clock::time_point FromSeconds(std::string_view seconds) {
+  return ConnectionCache::Clock::time_point(
+      std::chrono::seconds(std::stoll(std::string(seconds))));
+}
+
+int64_t ToSeconds(ConnectionCache::Clock::time_point tp) {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             tp.time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+// static
+std::string ConnectionCache::AddressKey(std::string_view host, long port) {
+  return std::string(host) + ":" + std::to_string(port);
+}
+
+void ConnectionCache::StoreAddress(std::string_view host, long port,
+                                   std::string_view address,
+                                   Clock::time_point now) {
+  if (host.empty() || address.empty() || !IsField(host) || !IsField(address)) {
+    return;
+  }
+
+  // Connecting to an address we handed to curl ourselves says nothing about
+  // whether DNS still agrees with it, so that mustn't extend its life.
+  auto& entry = addresses_[AddressKey(host, port)];
+  if (entry.address == address && entry.expires > now) {
+    return;
+  }
+
+  entry = Address{std::string(address), now + address_ttl_};
+}
+
+void ConnectionCache::ForgetAddress(std::string_view host, long port) {
+  addresses_.erase(AddressKey(host, port));
+}
+
+std::vector<std::string> ConnectionCache::Addresses(
+    Clock::time_point now) const {
+  std::vector<std::string> resolve;
+
+  for (const auto& [key, entry] : addresses_) {
+    if (entry.expires <= now) {
+      continue;
+    }
+
+    // IPv6 addresses are bracketed, so that their colons can't be mistaken
+    // for the separator.
+    if (entry.address.find(':') != entry.address.npos) {
+      resolve.push_back(key + ":[" + entry.address + "]");
+    } else {
+      resolve.push_back(key + ":" + entry.address);
+    }
+  }
+
+  return resolve;
+}
+
+void ConnectionCache::StoreSession(TlsSession session) {
+  if (session.key.empty() || !IsField(session.key)) {
+    return;
+  }
+
+  auto key = session.key;
+  sessions_[std::move(key)] = std::move(session);
+}
+
+std::vector<ConnectionCache::TlsSession> ConnectionCache::Sessions(
+    Clock::time_point now) const {
+  std::vector<TlsSession> sessions;
+
+  for (const auto& [key, session] : sessions_) {
+    if (session.valid_until > now) {
+      sessions.push_back(session);
+    }
+  }
+
+  return sessions;
+}
+
+void ConnectionCache::Load(const fs::path& path) {
+  std::ifstream file(path);
+
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto fields = Split(line, '\t');
+    if (fields.size() < 2 || !IsDigits(fields[1])) {
+      continue;
+    }
+
+    if (fields[0] == kAddress && fields.size() == 4) {
+      addresses_[std::string(fields[2])] =
+          Address{std::string(fields[3]), FromSeconds(fields[1])};
+    } else if (fields[0] == kSession && fields.size() == 5) {
+      TlsSession session;
+      session.key = fields[2];
+      session.valid_until = FromSeconds(fields[1]);
+      if (HexDecode(fields[3], &session.shmac) &&
+          HexDecode(fields[4], &session.data)) {
+        StoreSession(std::move(session));
+      }
+    }
+  }
+}
+
+bool ConnectionCache::Save(const fs::path& path, Clock::time_point now) const {
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  if (ec) {
+    return false;
+  }
+
+  auto tmp = path;
+  tmp += ".tmp";
+
+  {
+    std::ofstream file(tmp, std::ofstream::trunc);
+    fs::permissions(tmp, fs::perms::owner_read | fs::perms::owner_write, ec);
+    if (ec) {
+      return false;
+    }
+
+    for (const auto& [key, entry] : addresses_) {
+      if (entry.expires <= now) {
+        continue;
+      }
+
+      file << kAddress << '\t' << ToSeconds(entry.expires) << '\t' << key
+           << '\t' << entry.address << '\n';
+    }
+
+    for (const auto& [key, session] : sessions_) {
+      if (session.valid_until <= now) {
+        continue;
+      }
+
+      file << kSession << '\t' << ToSeconds(session.valid_until) << '\t' << key
+           << '\t' << HexEncode(session.shmac) << '\t'
+           << HexEncode(session.data) << '\n';
+    }
+
+    if (!file.flush()) {
+      return false;
+    }
+  }
+
+  fs::rename(tmp, path, ec);
+  return !ec;
+}
+
+}  // namespace aur
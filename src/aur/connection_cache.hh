@@ -0,0 +1,79 @@
+#ifndef AUR_CONNECTION_CACHE_HH_
+#define AUR_CONNECTION_CACHE_HH_
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aur {
+
+// A persistent record of what it took to connect to a server: the address its
+// name resolved to, and the TLS sessions it handed out. Feeding these back
+// into curl lets a short-lived process skip the DNS lookup and resume a TLS
+// session instead of performing a full handshake.
+class ConnectionCache {
+ public:
+  using Clock = std::chrono::system_clock;
+
+  struct TlsSession {
+    std::string key;
+    std::string shmac;
+    std::string data;
+    Clock::time_point valid_until;
+  };
+
+  // Resolved addresses are trusted for |address_ttl|. curl doesn't report the
+  // TTL of the DNS records themselves.
+  explicit ConnectionCache(std::chrono::seconds address_ttl)
+      : address_ttl_(address_ttl) {}
+  ~ConnectionCache() = default;
+
+  ConnectionCache(const ConnectionCache&) = delete;
+  ConnectionCache& operator=(const ConnectionCache&) = delete;
+
+  ConnectionCache(ConnectionCache&&) = default;
+  ConnectionCache& operator=(ConnectionCache&&) = default;
+
+  void StoreAddress(std::string_view host, long port, std::string_view address,
+                    Clock::time_point now);
+
+  // Drops the address for a server which couldn't be reached, in case it's
+  // the address that was wrong.
+  void ForgetAddress(std::string_view host, long port);
+
+  // Returns unexpired addresses in the HOST:PORT:ADDRESS form which
+  // CURLOPT_RESOLVE expects.
+  std::vector<std::string> Addresses(Clock::time_point now) const;
+
+  void StoreSession(TlsSession session);
+
+  // Returns the sessions which are still valid.
+  std::vector<TlsSession> Sessions(Clock::time_point now) const;
+
+  // Loading a missing or malformed file isn't an error, it simply leaves the
+  // cache empty. Expired entries are dropped on save. The file holds TLS
+  // session secrets, so it's only readable by its owner.
+  void Load(const std::filesystem::path& path);
+  bool Save(const std::filesystem::path& path, Clock::time_point now) const;
+
+ private:
+  struct Address {
+    std::string address;
+    Clock::time_point expires;
+  };
+
+  static std::string AddressKey(std::string_view host, long port);
+
+  std::chrono::seconds address_ttl_;
+
+  // Keyed on HOST:PORT, and on the session key, respectively.
+  std::map<std::string, Address> addresses_;
+  std::map<std::string, TlsSession> sessions_;
+};
+
+}  // namespace aur
+
+#endif  // AUR_CONNECTION_CACHE_HH_
@@ -0,0 +1,127 @@
+#include "connection_cache.hh"
+
+#include <stdlib.h>
+
+#include <fstream>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace fs = std::filesystem;
+
+using aur::ConnectionCache;
+using testing::ElementsAre;
+using testing::Field;
+using testing::IsEmpty;
+
+namespace {
+
+constexpr std::chrono::seconds kTtl(600);
+
+ConnectionCache::Clock::time_point Time(int64_t seconds) {
+  return ConnectionCache::Clock::time_point(std::chrono::seconds(seconds));
+}
+
+ConnectionCache::TlsSession MakeSession(std::string key, int64_t valid_until) {
+  ConnectionCache::TlsSession session;
+  session.key = std::move(key);
+  session.shmac = std::string("\x01\xff", 2);
+  session.data = std::string("\0\t\n", 3);
+  session.valid_until = Time(valid_until);
+  return session;
+}
+
+TEST(ConnectionCacheTest, AddressesExpire) {
+  ConnectionCache cache(kTtl);
+  cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.15", Time(1000));
+  cache.StoreAddress("example.com", 443, "2001:db8::1", Time(1000));
+
+  EXPECT_THAT(cache.Addresses(Time(1000)),
+              ElementsAre("aur.archlinux.org:443:95.216.144.15",
+                          "example.com:443:[2001:db8::1]"));
+  EXPECT_THAT(cache.Addresses(Time(1000 + kTtl.count())), IsEmpty());
+}
+
+TEST(ConnectionCacheTest, ReconnectingDoesNotExtendAddresses) {
+  ConnectionCache cache(kTtl);
+  cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.15", Time(1000));
+  cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.15", Time(1500));
+  EXPECT_THAT(cache.Addresses(Time(1000 + kTtl.count())), IsEmpty());
+
+  // A changed address is a fresh lookup, though.
+  cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.15", Time(2000));
+  cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.16", Time(2100));
+  EXPECT_THAT(cache.Addresses(Time(2100 + kTtl.count() - 1)),
+              ElementsAre("aur.archlinux.org:443:95.216.144.16"));
+}
+
+TEST(ConnectionCacheTest, ForgetsUnreachableAddresses) {
+  ConnectionCache cache(kTtl);
+  cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.15", Time(1000));
+  cache.ForgetAddress("aur.archlinux.org", 443);
+  EXPECT_THAT(cache.Addresses(Time(1000)), IsEmpty());
+}
+
+TEST(ConnectionCacheTest, SessionsExpire) {
+  ConnectionCache cache(kTtl);
+  cache.StoreSession(MakeSession("aur.archlinux.org:443", 2000));
+
+  EXPECT_THAT(cache.Sessions(Time(1999)),
+              ElementsAre(Field(&ConnectionCache::TlsSession::key,
+                                "aur.archlinux.org:443")));
+  EXPECT_THAT(cache.Sessions(Time(2000)), IsEmpty());
+}
+
+TEST(ConnectionCacheTest, RoundTripsThroughFile) {
+  char tmpdir[] = "/tmp/connection_cache_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = fs::path(tmpdir) / "cache" / "connections";
+
+  {
+    ConnectionCache cache(kTtl);
+    cache.StoreAddress("aur.archlinux.org", 443, "95.216.144.15", Time(1000));
+    cache.StoreAddress("old.example.com", 443, "192.0.2.1", Time(0));
+    cache.StoreSession(MakeSession("aur.archlinux.org:443", 5000));
+    cache.StoreSession(MakeSession("old.example.com:443", 1000));
+    ASSERT_TRUE(cache.Save(path, Time(1000)));
+  }
+
+  EXPECT_EQ(fs::status(path).permissions() & fs::perms::all,
+            fs::perms::owner_read | fs::perms::owner_write);
+
+  ConnectionCache cache(kTtl);
+  cache.Load(path);
+
+  EXPECT_THAT(cache.Addresses(Time(1000)),
+              ElementsAre("aur.archlinux.org:443:95.216.144.15"));
+
+  const auto sessions = cache.Sessions(Time(1000));
+  ASSERT_EQ(sessions.size(), 1);
+  EXPECT_EQ(sessions[0].key, "aur.archlinux.org:443");
+  EXPECT_EQ(sessions[0].shmac, std::string("\x01\xff", 2));
+  EXPECT_EQ(sessions[0].data, std::string("\0\t\n", 3));
+  EXPECT_EQ(sessions[0].valid_until, Time(5000));
+
+  fs::remove_all(tmpdir);
+}
+
+TEST(ConnectionCacheTest, IgnoresMalformedLines) {
+  char tmpdir[] = "/tmp/connection_cache_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = fs::path(tmpdir) / "connections";
+
+  std::ofstream(path) << "address\tsoon\taur.archlinux.org:443\t95.216.144.15\n"
+                      << "session\t5000\taur.archlinux.org:443\tzz\t00\n"
+                      << "bogus\n"
+                      << "address\t5000\taur.archlinux.org:443\t1.2.3.4\n";
+
+  ConnectionCache cache(kTtl);
+  cache.Load(path);
+  EXPECT_THAT(cache.Addresses(Time(1000)),
+              ElementsAre("aur.archlinux.org:443:1.2.3.4"));
+  EXPECT_THAT(cache.Sessions(Time(1000)), IsEmpty());
+
+  fs::remove_all(tmpdir);
+}
+
+}  // namespace
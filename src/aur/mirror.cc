@@ -0,0 +1,189 @@
+#include "mirror.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace aur {
+
+namespace {
+
+constexpr std::string_view kFileScheme = "file://";
+constexpr std::string_view kSourceFilePath = "/cgit/aur.git/plain/";
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+std::string UrlUnescape(std::string_view escaped) {
+  std::string out;
+  out.reserve(escaped.size());
+
+  for (size_t i = 0; i < escaped.size(); ++i) {
+    if (escaped[i] == '%' && i + 2 < escaped.size() &&
+        HexValue(escaped[i + 1]) >= 0 && HexValue(escaped[i + 2]) >= 0) {
+      out.push_back(HexValue(escaped[i + 1]) << 4 | HexValue(escaped[i + 2]));
+      i += 2;
+    } else {
+      out.push_back(escaped[i]);
+    }
+  }
+
+  return out;
+}
+
+std::vector<std::pair<std::string_view, std::string>> ParseQuery(
+    std::string_view query) {
+  std::vector<std::pair<std::string_view, std::string>> params;
+
+  while (!query.empty()) {
+    auto param = query.substr(0, query.find('&'));
+    query.remove_prefix(std::min(query.size(), param.size() + 1));
+
+    const auto eq = param.find('=');
+    if (eq == param.npos) {
+      params.emplace_back(param, std::string());
+    } else {
+      params.emplace_back(param.substr(0, eq),
+                          UrlUnescape(param.substr(eq + 1)));
+    }
+  }
+
+  return params;
+}
+
+// Names become path components under the mirror's root, so they mustn't be
+// able to refer to anything outside of it.
+bool IsSafePathComponent(std::string_view name) {
+  return !name.empty() && name != "." && name != ".." &&
+         name.find('/') == name.npos;
+}
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream file(path, std::ifstream::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::stringstream data;
+  data << file.rdbuf();
+  *contents = data.str();
+  return true;
+}
+
+Exchange MakeResponse(long status, std::string body) {
+  Exchange exchange;
+  exchange.status = status;
+  exchange.body = std::move(body);
+  return exchange;
+}
+
+std::string RpcError(std::string_view message) {
+  std::string body = R"({"version":5,"type":"error","resultcount":0,)"
+                     R"("results":[],"error":")";
+  body.append(message);
+  body.append(R"("})");
+  return body;
+}
+
+}  // namespace
+
+LocalMirror::LocalMirror(std::string_view baseurl)
+    : baseurl_(baseurl), root_(baseurl.substr(kFileScheme.size())) {}
+
+// static
+bool LocalMirror::IsLocal(std::string_view baseurl) {
+  return baseurl.substr(0, kFileScheme.size()) == kFileScheme;
+}
+
+Exchange LocalMirror::Fetch(const std::string& url) const {
+  Exchange response = MakeResponse(404, std::string());
+
+  std::string_view request(url);
+  if (request.substr(0, baseurl_.size()) == baseurl_) {
+    request.remove_prefix(baseurl_.size());
+
+    const auto qmark = request.find('?');
+    const auto path = request.substr(0, qmark);
+    const auto query =
+        qmark == request.npos ? std::string_view() : request.substr(qmark + 1);
+
+    if (path == "/rpc") {
+      response = FetchInfo(query);
+    } else if (path.substr(0, kSourceFilePath.size()) == kSourceFilePath) {
+      response = FetchSourceFile(path.substr(kSourceFilePath.size()), query);
+    }
+  }
+
+  response.url = url;
+  return response;
+}
+
+Exchange LocalMirror::FetchInfo(std::string_view query) const {
+  std::string type;
+  std::vector<std::string> names;
+  for (auto& [key, value] : ParseQuery(query)) {
+    if (key == "type") {
+      type = std::move(value);
+    } else if (key == "arg[]") {
+      names.push_back(std::move(value));
+    }
+  }
+
+  if (type != "info" && type != "multiinfo") {
+    return MakeResponse(
+        200, RpcError("Only info queries can be answered by a local mirror"));
+  }
+
+  std::string results;
+  int resultcount = 0;
+  for (const auto& name : names) {
+    std::string entry;
+    if (!IsSafePathComponent(name) ||
+        !ReadFile(root_ + "/info/" + name + ".json", &entry)) {
+      continue;
+    }
+
+    if (resultcount++ > 0) {
+      results.push_back(',');
+    }
+    results.append(entry);
+  }
+
+  return MakeResponse(200, R"({"version":5,"type":"multiinfo","resultcount":)" +
+                               std::to_string(resultcount) +
+                               R"(,"results":[)" + results + "]}");
+}
+
+Exchange LocalMirror::FetchSourceFile(std::string_view filename,
+                                      std::string_view query) const {
+  std::string pkgbase;
+  for (auto& [key, value] : ParseQuery(query)) {
+    if (key == "h") {
+      pkgbase = std::move(value);
+    }
+  }
+
+  const auto file = UrlUnescape(filename);
+
+  std::string contents;
+  if (!IsSafePathComponent(pkgbase) || !IsSafePathComponent(file) ||
+      !ReadFile(root_ + "/" + pkgbase + "/" + file, &contents)) {
+    return MakeResponse(404, std::string());
+  }
+
+  return MakeResponse(200, std::move(contents));
+}
+
+}  // namespace aur
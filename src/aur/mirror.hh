@@ -0,0 +1,41 @@
+#ifndef AUR_MIRROR_HH_
+#define AUR_MIRROR_HH_
+
+#include <string>
+#include <string_view>
+
+#include "transcript.hh"
+
+namespace aur {
+
+// Answers requests for a file:// base URL from a local mirror of the AUR,
+// laid out as:
+//
+//   <root>/info/<pkgname>.json   the package's entry in RPC info results
+//   <root>/<pkgbase>/            a checkout of the pkgbase's git repository
+//
+// Info queries gather the entries of whichever named packages are present.
+// Source files are read from the checkouts, which git can also clone from
+// directly. Other RPC queries, such as searches, can't be answered locally.
+class LocalMirror {
+ public:
+  // |baseurl| must satisfy IsLocal().
+  explicit LocalMirror(std::string_view baseurl);
+
+  static bool IsLocal(std::string_view baseurl);
+
+  // Returns the response to a request for |url|, as the AUR would give it.
+  Exchange Fetch(const std::string& url) const;
+
+ private:
+  Exchange FetchInfo(std::string_view query) const;
+  Exchange FetchSourceFile(std::string_view filename,
+                           std::string_view query) const;
+
+  std::string baseurl_;
+  std::string root_;
+};
+
+}  // namespace aur
+
+#endif  // AUR_MIRROR_HH_
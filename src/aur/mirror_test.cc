@@ -0,0 +1,112 @@
+#include "mirror.hh"
+
+#include <stdlib.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "request.hh"
+#include "response.hh"
+
+namespace fs = std::filesystem;
+
+using testing::ElementsAre;
+using testing::Field;
+
+namespace {
+
+class LocalMirrorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_NE(mkdtemp(root_), nullptr);
+    baseurl_ = std::string("file://") + root_;
+
+    WriteFile("info/auracle-git.json",
+              R"({"Name":"auracle-git","PackageBase":"auracle-git"})");
+    WriteFile("info/pkgfile-git.json",
+              R"({"Name":"pkgfile-git","PackageBase":"pkgfile-git"})");
+    WriteFile("auracle-git/PKGBUILD", "pkgname=auracle-git\n");
+  }
+
+  void TearDown() override { fs::remove_all(root_); }
+
+  void WriteFile(const std::string& path, std::string_view contents) {
+    const auto full_path = fs::path(root_) / path;
+    fs::create_directories(full_path.parent_path());
+    std::ofstream(full_path) << contents;
+  }
+
+  aur::Exchange Fetch(const aur::Request& request) {
+    const auto urls = request.Build(baseurl_);
+    EXPECT_EQ(urls.size(), 1);
+    return aur::LocalMirror(baseurl_).Fetch(urls[0]);
+  }
+
+  char root_[32] = "/tmp/mirror_test.XXXXXX";
+  std::string baseurl_;
+};
+
+TEST_F(LocalMirrorTest, RecognizesFileUrls) {
+  EXPECT_TRUE(aur::LocalMirror::IsLocal("file:///srv/aur"));
+  EXPECT_FALSE(aur::LocalMirror::IsLocal("https://aur.archlinux.org"));
+}
+
+TEST_F(LocalMirrorTest, AnswersInfoQueries) {
+  aur::InfoRequest request;
+  request.AddArg("auracle-git");
+  request.AddArg("notfound");
+  request.AddArg("pkgfile-git");
+
+  const auto response = Fetch(request);
+  EXPECT_EQ(response.status, 200);
+
+  const aur::RpcResponse rpc(response.body);
+  EXPECT_EQ(rpc.type, "multiinfo");
+  EXPECT_EQ(rpc.resultcount, 2);
+  EXPECT_THAT(rpc.results,
+              ElementsAre(Field(&aur::Package::name, "auracle-git"),
+                          Field(&aur::Package::name, "pkgfile-git")));
+}
+
+TEST_F(LocalMirrorTest, RefusesOtherQueries) {
+  const auto response =
+      Fetch(aur::SearchRequest(aur::SearchRequest::SearchBy::NAME, "aura"));
+  EXPECT_EQ(response.status, 200);
+
+  const aur::RpcResponse rpc(response.body);
+  EXPECT_EQ(rpc.type, "error");
+  EXPECT_FALSE(rpc.error.empty());
+}
+
+TEST_F(LocalMirrorTest, ServesSourceFiles) {
+  aur::Package package;
+  package.pkgbase = "auracle-git";
+
+  auto response = Fetch(aur::RawRequest::ForSourceFile(package, "PKGBUILD"));
+  EXPECT_EQ(response.status, 200);
+  EXPECT_EQ(response.body, "pkgname=auracle-git\n");
+
+  response = Fetch(aur::RawRequest::ForSourceFile(package, ".SRCINFO"));
+  EXPECT_EQ(response.status, 404);
+}
+
+TEST_F(LocalMirrorTest, StaysInsideRoot) {
+  WriteFile("secret", "hunter2");
+
+  aur::Package package;
+  package.pkgbase = "..";
+  EXPECT_EQ(Fetch(aur::RawRequest::ForSourceFile(package, "secret")).status,
+            404);
+
+  package.pkgbase = "auracle-git";
+  EXPECT_EQ(Fetch(aur::RawRequest::ForSourceFile(package, "../secret")).status,
+            404);
+
+  aur::InfoRequest request;
+  request.AddArg("../secret");
+  EXPECT_EQ(aur::RpcResponse(Fetch(request).body).resultcount, 0);
+}
+
+}  // namespace
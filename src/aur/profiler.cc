@@ -0,0 +1,206 @@
+#include "profiler.hh"
+
+#include <signal.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <cerrno>
+#include <map>
+
+namespace aur {
+
+namespace {
+
+// The phase stack, innermost phase in the low nibble. Phases are nonzero, so
+// an empty stack is zero and the depth needs no storing of its own.
+constexpr int kPhaseBits = 4;
+constexpr int kMaxDepth = 64 / kPhaseBits;
+
+// Samples are counted in a fixed open-addressed table keyed on the phase
+// stack, so that the signal handler never allocates. There are far fewer
+// distinct stacks than slots in practice; samples that find no room are
+// counted as lost rather than dropped silently.
+constexpr int kSlotBits = 12;
+constexpr size_t kSlots = size_t{1} << kSlotBits;
+
+struct Slot {
+  std::atomic<uint64_t> stack;
+  std::atomic<uint64_t> count;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the signal handler relies on lock free atomics");
+
+std::atomic<uint64_t> phase_stack{0};
+
+Slot samples[kSlots];
+std::atomic<uint64_t> unphased_samples{0};
+std::atomic<uint64_t> lost_samples{0};
+
+bool running = false;
+struct sigaction saved_action;
+
+void Record(uint64_t stack) {
+  if (stack == 0) {
+    unphased_samples.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  size_t index = (stack * 0x9e3779b97f4a7c15) >> (64 - kSlotBits);
+  for (size_t probes = 0; probes < kSlots; ++probes) {
+    auto& slot = samples[index];
+
+    uint64_t key = slot.stack.load(std::memory_order_relaxed);
+    if (key == 0 && slot.stack.compare_exchange_strong(
+                        key, stack, std::memory_order_relaxed)) {
+      key = stack;
+    }
+
+    if (key == stack) {
+      slot.count.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    index = (index + 1) & (kSlots - 1);
+  }
+
+  lost_samples.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OnSample(int) {
+  const int saved_errno = errno;
+  Record(phase_stack.load(std::memory_order_relaxed));
+  errno = saved_errno;
+}
+
+const char* PhaseName(Profiler::Phase phase) {
+  switch (phase) {
+    case Profiler::Phase::CONFIG:
+      return "config";
+    case Profiler::Phase::NETWORK_WAIT:
+      return "network-wait";
+    case Profiler::Phase::DECODE:
+      return "decode";
+    case Profiler::Phase::RESOLVE:
+      return "resolve";
+    case Profiler::Phase::FILTER:
+      return "filter";
+    case Profiler::Phase::SORT:
+      return "sort";
+    case Profiler::Phase::FORMAT:
+      return "format";
+  }
+
+  return "[unknown]";
+}
+
+std::string FoldedStack(uint64_t stack) {
+  std::string folded = "auracle";
+
+  for (int depth = kMaxDepth - 1; depth >= 0; --depth) {
+    const auto phase = (stack >> (depth * kPhaseBits)) & 0xf;
+    if (phase != 0) {
+      folded.push_back(';');
+      folded.append(PhaseName(static_cast<Profiler::Phase>(phase)));
+    }
+  }
+
+  return folded;
+}
+
+void Reset() {
+  for (auto& slot : samples) {
+    slot.stack.store(0, std::memory_order_relaxed);
+    slot.count.store(0, std::memory_order_relaxed);
+  }
+  unphased_samples.store(0, std::memory_order_relaxed);
+  lost_samples.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+Profiler::Scope::Scope(Phase phase)
+    : saved_(phase_stack.load(std::memory_order_relaxed)) {
+  const auto top = static_cast<uint64_t>(phase);
+  if ((saved_ & 0xf) != top && saved_ >> (64 - kPhaseBits) == 0) {
+    phase_stack.store(saved_ << kPhaseBits | top, std::memory_order_relaxed);
+  }
+}
+
+Profiler::Scope::~Scope() {
+  phase_stack.store(saved_, std::memory_order_relaxed);
+}
+
+// static
+bool Profiler::Start(std::chrono::microseconds interval) {
+  if (running || interval.count() <= 0) {
+    return false;
+  }
+
+  Reset();
+
+  // SA_RESTART keeps the sampling mostly invisible to the rest of the
+  // process. Calls which are never restarted, like epoll_wait, already have
+  // to cope with EINTR.
+  struct sigaction action = {};
+  action.sa_handler = &OnSample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGALRM, &action, &saved_action) < 0) {
+    return false;
+  }
+
+  struct itimerval timer = {};
+  timer.it_interval.tv_sec = interval.count() / 1000000;
+  timer.it_interval.tv_usec = interval.count() % 1000000;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_REAL, &timer, nullptr) < 0) {
+    sigaction(SIGALRM, &saved_action, nullptr);
+    return false;
+  }
+
+  running = true;
+  return true;
+}
+
+// static
+std::string Profiler::Stop() {
+  if (!running) {
+    return std::string();
+  }
+
+  struct itimerval timer = {};
+  setitimer(ITIMER_REAL, &timer, nullptr);
+  sigaction(SIGALRM, &saved_action, nullptr);
+  running = false;
+
+  std::map<std::string, uint64_t> folded;
+  for (const auto& slot : samples) {
+    const auto stack = slot.stack.load(std::memory_order_relaxed);
+    if (stack != 0) {
+      folded[FoldedStack(stack)] += slot.count.load(std::memory_order_relaxed);
+    }
+  }
+
+  if (const auto count = unphased_samples.load(std::memory_order_relaxed);
+      count > 0) {
+    folded["auracle"] += count;
+  }
+
+  if (const auto count = lost_samples.load(std::memory_order_relaxed);
+      count > 0) {
+    folded["auracle;[lost]"] += count;
+  }
+
+  std::string out;
+  for (const auto& [stack, count] : folded) {
+    out.append(stack);
+    out.push_back(' ');
+    out.append(std::to_string(count));
+    out.push_back('\n');
+  }
+
+  return out;
+}
+
+}  // namespace aur
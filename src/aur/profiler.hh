@@ -0,0 +1,64 @@
+#ifndef AUR_PROFILER_HH_
+#define AUR_PROFILER_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace aur {
+
+// A sampling profiler which attributes time to the phase of work the process
+// is in, rather than to individual functions. Phases nest, so a sample taken
+// while decoding a response inside of a network wait is charged to
+// "network-wait;decode".
+//
+// Samples are driven by a wall clock timer, so time spent blocked on the
+// network is seen just as well as time spent on the CPU. Marking a phase is
+// cheap enough to leave in place when the profiler isn't running.
+class Profiler {
+ public:
+  enum class Phase : uint8_t {
+    CONFIG = 1,
+    NETWORK_WAIT,
+    DECODE,
+    RESOLVE,
+    FILTER,
+    SORT,
+    FORMAT,
+  };
+
+  // Charges samples to |phase|, nested within the enclosing scope's phase,
+  // for as long as the Scope is alive. Scopes must be destroyed in the
+  // reverse order of their creation. Entering the phase that's already
+  // innermost doesn't nest, and nesting beyond 16 levels deep is charged to
+  // the deepest phase which fits.
+  class Scope {
+   public:
+    explicit Scope(Phase phase);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    Scope(Scope&&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+   private:
+    uint64_t saved_;
+  };
+
+  Profiler() = delete;
+
+  // Starts taking a sample every |interval|. Returns false if the profiler is
+  // already running, or the timer couldn't be set up.
+  static bool Start(std::chrono::microseconds interval);
+
+  // Stops the profiler, and returns the samples taken as folded stacks, one
+  // per line in the form "auracle;network-wait;decode 42", as consumed by
+  // flamegraph tools. Returns an empty string if the profiler wasn't running.
+  static std::string Stop();
+};
+
+}  // namespace aur
+
+#endif  // AUR_PROFILER_HH_
@@ -0,0 +1,91 @@
+#include "profiler.hh"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::HasSubstr;
+using testing::Not;
+
+namespace {
+
+void Spin(std::chrono::milliseconds duration) {
+  const auto deadline = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
+TEST(ProfilerTest, StopWithoutStartIsEmpty) {
+  EXPECT_EQ(aur::Profiler::Stop(), "");
+}
+
+TEST(ProfilerTest, RefusesToStartTwice) {
+  ASSERT_TRUE(aur::Profiler::Start(std::chrono::milliseconds(1)));
+  EXPECT_FALSE(aur::Profiler::Start(std::chrono::milliseconds(1)));
+  aur::Profiler::Stop();
+}
+
+TEST(ProfilerTest, FoldsNestedPhases) {
+  ASSERT_TRUE(aur::Profiler::Start(std::chrono::microseconds(500)));
+
+  {
+    aur::Profiler::Scope resolve(aur::Profiler::Phase::RESOLVE);
+    Spin(std::chrono::milliseconds(50));
+
+    {
+      aur::Profiler::Scope sort(aur::Profiler::Phase::SORT);
+      Spin(std::chrono::milliseconds(50));
+    }
+  }
+
+  const auto folded = aur::Profiler::Stop();
+  EXPECT_THAT(folded, HasSubstr("auracle;resolve "));
+  EXPECT_THAT(folded, HasSubstr("auracle;resolve;sort "));
+  EXPECT_THAT(folded, Not(HasSubstr("[lost]")));
+}
+
+TEST(ProfilerTest, ReenteringThePhaseDoesNotNest) {
+  ASSERT_TRUE(aur::Profiler::Start(std::chrono::microseconds(500)));
+
+  {
+    aur::Profiler::Scope outer(aur::Profiler::Phase::FORMAT);
+    aur::Profiler::Scope inner(aur::Profiler::Phase::FORMAT);
+    Spin(std::chrono::milliseconds(50));
+  }
+
+  const auto folded = aur::Profiler::Stop();
+  EXPECT_THAT(folded, HasSubstr("auracle;format "));
+  EXPECT_THAT(folded, Not(HasSubstr("format;format")));
+}
+
+TEST(ProfilerTest, ChargesTheDeepestPhaseThatFits) {
+  ASSERT_TRUE(aur::Profiler::Start(std::chrono::microseconds(500)));
+
+  {
+    std::vector<std::unique_ptr<aur::Profiler::Scope>> scopes;
+    for (int i = 0; i < 20; ++i) {
+      scopes.push_back(std::make_unique<aur::Profiler::Scope>(
+          i < 16 ? static_cast<aur::Profiler::Phase>(i % 2 + 1)
+                 : aur::Profiler::Phase::FORMAT));
+    }
+    Spin(std::chrono::milliseconds(50));
+
+    while (!scopes.empty()) {
+      scopes.pop_back();
+    }
+  }
+
+  {
+    aur::Profiler::Scope filter(aur::Profiler::Phase::FILTER);
+    Spin(std::chrono::milliseconds(50));
+  }
+
+  const auto folded = aur::Profiler::Stop();
+  EXPECT_THAT(folded, Not(HasSubstr("format")));
+  EXPECT_THAT(folded, HasSubstr("auracle;filter "));
+}
+
+}  // namespace
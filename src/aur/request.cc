@@ -119,4 +119,22 @@ std::vector<std::string> CloneRequest::Build(std::string_view baseurl) const {
   return {StrCat(baseurl, "/", reponame_)};
 }
 
+std::vector<std::string> VcsHeadRequest::Build(std::string_view) const {
+  switch (vcs_) {
+    case Vcs::GIT:
+      return {"git", "ls-remote", "--quiet", "--", url_,
+              ref_.empty() ? "HEAD" : ref_};
+    case Vcs::HG:
+      if (ref_.empty()) {
+        return {"hg", "identify", "--id", "--", url_};
+      }
+      return {"hg", "identify", "--id", "--rev", ref_, "--", url_};
+    case Vcs::SVN:
+      return {"svn", "info", "--show-item", "last-changed-revision", "--",
+              url_};
+  }
+
+  return {};
+}
+
 }  // namespace aur
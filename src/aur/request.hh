@@ -9,16 +9,42 @@
 
 namespace aur {
 
+// How urgently a request is wanted. Queued requests are dispatched in order
+// of priority, and those queued at the same priority in the order they were
+// queued.
+enum class Priority {
+  // Lookups which further work is waiting on, such as resolving dependencies.
+  RESOLUTION,
+
+  // Lookups whose results are simply reported.
+  METADATA,
+
+  // Fetches of package content, such as clones and source files.
+  BULK,
+};
+
 // Abstract class describing a request for a resource.
 class Request {
  public:
   virtual ~Request() = default;
 
   virtual std::vector<std::string> Build(std::string_view baseurl) const = 0;
+
+  Priority priority() const { return priority_; }
+  void set_priority(Priority priority) { priority_ = priority; }
+
+ protected:
+  explicit Request(Priority priority = Priority::METADATA)
+      : priority_(priority) {}
+
+ private:
+  Priority priority_;
 };
 
 class HttpRequest : public Request {
  public:
+  using Request::Request;
+
   using QueryParam = std::pair<std::string, std::string>;
   using QueryParams = std::vector<QueryParam>;
 };
@@ -29,7 +55,8 @@ class RawRequest : public HttpRequest {
   static RawRequest ForSourceFile(const Package& package,
                                   std::string_view filename);
 
-  explicit RawRequest(std::string urlpath) : urlpath_(std::move(urlpath)) {}
+  explicit RawRequest(std::string urlpath)
+      : HttpRequest(Priority::BULK), urlpath_(std::move(urlpath)) {}
 
   RawRequest(const RawRequest&) = delete;
   RawRequest& operator=(const RawRequest&) = delete;
@@ -47,7 +74,7 @@ class RawRequest : public HttpRequest {
 class CloneRequest : public Request {
  public:
   explicit CloneRequest(std::string reponame)
-      : reponame_(std::move(reponame)) {}
+      : Request(Priority::BULK), reponame_(std::move(reponame)) {}
 
   CloneRequest(const CloneRequest&) = delete;
   CloneRequest& operator=(const CloneRequest&) = delete;
@@ -63,6 +90,40 @@ class CloneRequest : public Request {
   std::string reponame_;
 };
 
+// A class describing a query for the current head of an upstream VCS
+// repository, such as one named in the source array of a PKGBUILD.
+class VcsHeadRequest : public Request {
+ public:
+  enum class Vcs {
+    GIT,
+    HG,
+    SVN,
+  };
+
+  // An empty |ref| refers to the repository's default branch.
+  VcsHeadRequest(Vcs vcs, std::string url, std::string ref = std::string())
+      : vcs_(vcs), url_(std::move(url)), ref_(std::move(ref)) {}
+
+  VcsHeadRequest(const VcsHeadRequest&) = delete;
+  VcsHeadRequest& operator=(const VcsHeadRequest&) = delete;
+
+  VcsHeadRequest(VcsHeadRequest&&) = default;
+  VcsHeadRequest& operator=(VcsHeadRequest&&) = default;
+
+  Vcs vcs() const { return vcs_; }
+  const std::string& url() const { return url_; }
+  const std::string& ref() const { return ref_; }
+
+  // Returns the command line which queries the upstream head. The baseurl is
+  // ignored, as these repositories don't live on the AUR.
+  std::vector<std::string> Build(std::string_view baseurl) const override;
+
+ private:
+  Vcs vcs_;
+  std::string url_;
+  std::string ref_;
+};
+
 // A base class describing a GET request to the RPC endpoint of the AUR.
 class RpcRequest : public HttpRequest {
  public:
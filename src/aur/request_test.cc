@@ -120,3 +120,49 @@ TEST(RequestTest, BuildsCloneRequests) {
   const auto& url = urls[0];
   EXPECT_EQ(url, std::string(kBaseUrl) + "/" + kReponame);
 }
+
+TEST(RequestTest, BuildsVcsHeadRequests) {
+  using Vcs = aur::VcsHeadRequest::Vcs;
+
+  EXPECT_THAT(
+      aur::VcsHeadRequest(Vcs::GIT, "https://example.com/foo.git")
+          .Build(kBaseUrl),
+      testing::ElementsAre("git", "ls-remote", "--quiet", "--",
+                           "https://example.com/foo.git", "HEAD"));
+
+  EXPECT_THAT(aur::VcsHeadRequest(Vcs::GIT, "https://example.com/foo.git",
+                                  "refs/heads/devel")
+                  .Build(kBaseUrl),
+              testing::ElementsAre("git", "ls-remote", "--quiet", "--",
+                                   "https://example.com/foo.git",
+                                   "refs/heads/devel"));
+
+  EXPECT_THAT(
+      aur::VcsHeadRequest(Vcs::HG, "https://example.com/bar", "stable")
+          .Build(kBaseUrl),
+      testing::ElementsAre("hg", "identify", "--id", "--rev", "stable",
+                           "--", "https://example.com/bar"));
+
+  EXPECT_THAT(
+      aur::VcsHeadRequest(Vcs::SVN, "https://example.com/svn").Build(kBaseUrl),
+      testing::ElementsAre("svn", "info", "--show-item",
+                           "last-changed-revision", "--",
+                           "https://example.com/svn"));
+}
+
+TEST(RequestTest, DefaultsToPriorityByKind) {
+  EXPECT_EQ(aur::InfoRequest().priority(), aur::Priority::METADATA);
+  EXPECT_EQ(aur::SearchRequest(aur::SearchRequest::SearchBy::NAME, "foo")
+                .priority(),
+            aur::Priority::METADATA);
+  EXPECT_EQ(aur::RawRequest("/foo").priority(), aur::Priority::BULK);
+  EXPECT_EQ(aur::CloneRequest("foo").priority(), aur::Priority::BULK);
+  EXPECT_EQ(aur::VcsHeadRequest(aur::VcsHeadRequest::Vcs::GIT,
+                                "https://example.com/foo.git")
+                .priority(),
+            aur::Priority::METADATA);
+
+  aur::InfoRequest request;
+  request.set_priority(aur::Priority::RESOLUTION);
+  EXPECT_EQ(request.priority(), aur::Priority::RESOLUTION);
+}
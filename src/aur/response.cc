@@ -1,9 +1,87 @@
 #include "response.hh"
 
+#include <charconv>
+
 #include "json_internal.hh"
 
 namespace aur {
 
+namespace {
+
+constexpr std::string_view kJsonWhitespace = " \t\r\n";
+
+size_t SkipWhitespace(std::string_view s, size_t pos) {
+  pos = s.find_first_not_of(kJsonWhitespace, pos);
+  return pos == std::string_view::npos ? s.size() : pos;
+}
+
+// Returns the offset just past the string which opens at |pos|, or npos if the
+// string is unterminated.
+size_t SkipString(std::string_view s, size_t pos) {
+  for (++pos; pos < s.size(); ++pos) {
+    if (s[pos] == '\\') {
+      ++pos;
+    } else if (s[pos] == '"') {
+      return pos + 1;
+    }
+  }
+
+  return std::string_view::npos;
+}
+
+// Returns the offset just past the value which starts at |pos|, or npos if the
+// value is malformed. Nested values are skipped without being decoded.
+size_t SkipValue(std::string_view s, size_t pos) {
+  int depth = 0;
+
+  while (pos < s.size()) {
+    switch (s[pos]) {
+      case '"':
+        pos = SkipString(s, pos);
+        if (pos == std::string_view::npos) {
+          return pos;
+        }
+        if (depth == 0) {
+          return pos;
+        }
+        continue;
+      case '[':
+      case '{':
+        ++depth;
+        break;
+      case ']':
+      case '}':
+        if (depth == 0) {
+          return pos;
+        }
+        if (--depth == 0) {
+          return pos + 1;
+        }
+        break;
+      case ',':
+        if (depth == 0) {
+          return pos;
+        }
+        break;
+    }
+
+    ++pos;
+  }
+
+  return depth == 0 ? pos : std::string_view::npos;
+}
+
+std::string_view TrimJson(std::string_view s) {
+  const auto begin = s.find_first_not_of(kJsonWhitespace);
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
+
+  return s.substr(begin, s.find_last_not_of(kJsonWhitespace) - begin + 1);
+}
+
+}  // namespace
+
 void from_json(const nlohmann::json& j, RpcResponse& r) {
   // clang-format off
   static const auto& callbacks = *new CallbackMap<RpcResponse>{
@@ -32,4 +110,78 @@ RpcResponse::RpcResponse(const std::string& json_bytes) {
   }
 }
 
+bool RawResponse::ExtractResults(std::string_view* results,
+                                 int* resultcount) const {
+  const std::string_view s(bytes);
+  bool found_results = false, found_resultcount = false;
+
+  size_t pos = SkipWhitespace(s, 0);
+  if (pos == s.size() || s[pos] != '{') {
+    return false;
+  }
+
+  for (pos = SkipWhitespace(s, pos + 1); pos < s.size() && s[pos] != '}';) {
+    if (s[pos] != '"') {
+      return false;
+    }
+
+    const auto key_end = SkipString(s, pos);
+    if (key_end == std::string_view::npos) {
+      return false;
+    }
+    const auto key = s.substr(pos + 1, key_end - pos - 2);
+
+    pos = SkipWhitespace(s, key_end);
+    if (pos == s.size() || s[pos] != ':') {
+      return false;
+    }
+    pos = SkipWhitespace(s, pos + 1);
+
+    const auto value_end = SkipValue(s, pos);
+    if (value_end == std::string_view::npos) {
+      return false;
+    }
+    const auto value = TrimJson(s.substr(pos, value_end - pos));
+
+    if (key == "results") {
+      if (value.size() < 2 || value.front() != '[' || value.back() != ']') {
+        return false;
+      }
+      *results = TrimJson(value.substr(1, value.size() - 2));
+      found_results = true;
+    } else if (key == "type" && value == R"("error")") {
+      return false;
+    } else if (key == "resultcount") {
+      const auto [end, ec] =
+          std::from_chars(value.data(), value.data() + value.size(),
+                          *resultcount);
+      if (ec != std::errc() || end != value.data() + value.size()) {
+        return false;
+      }
+      found_resultcount = true;
+    }
+
+    pos = SkipWhitespace(s, value_end);
+    if (pos < s.size() && s[pos] == ',') {
+      pos = SkipWhitespace(s, pos + 1);
+    }
+  }
+
+  return found_results && found_resultcount;
+}
+
+VcsHeadResponse::VcsHeadResponse(std::string_view output) {
+  // All of git ls-remote, hg identify, and svn info lead with the value we're
+  // after, followed by whitespace.
+  constexpr std::string_view kWhitespace = " \t\r\n";
+
+  const auto begin = output.find_first_not_of(kWhitespace);
+  if (begin == std::string_view::npos) {
+    return;
+  }
+
+  output.remove_prefix(begin);
+  head = output.substr(0, output.find_first_of(kWhitespace));
+}
+
 }  // namespace aur
@@ -1,6 +1,8 @@
 #ifndef AUR_RESPONSE_HH_
 #define AUR_RESPONSE_HH_
 
+#include <string_view>
+
 #include "package.hh"
 
 namespace aur {
@@ -44,6 +46,21 @@ struct CloneResponse {
   std::string operation;
 };
 
+struct VcsHeadResponse {
+  // Parses the output of the command built by VcsHeadRequest.
+  explicit VcsHeadResponse(std::string_view output);
+
+  VcsHeadResponse(const VcsHeadResponse&) = delete;
+  VcsHeadResponse& operator=(const VcsHeadResponse&) = delete;
+
+  VcsHeadResponse(VcsHeadResponse&&) = default;
+  VcsHeadResponse& operator=(VcsHeadResponse&&) = default;
+
+  // A commit hash for git and hg, or a revision number for svn. Empty if the
+  // head couldn't be determined.
+  std::string head;
+};
+
 struct RpcResponse {
   RpcResponse() = default;
   explicit RpcResponse(const std::string& json_bytes);
@@ -70,6 +87,11 @@ struct RawResponse {
   RawResponse(RawResponse&&) = default;
   RawResponse& operator=(RawResponse&&) = default;
 
+  // Locates the contents of the top level results array of an RPC response,
+  // along with its resultcount, without decoding the rest of the document.
+  // Returns false if the response doesn't contain both, or is an error.
+  bool ExtractResults(std::string_view* results, int* resultcount) const;
+
   std::string bytes;
 };
 
@@ -136,3 +136,47 @@ TEST(ResponseTest, GracefullyHandlesInvalidJson) {
   ASSERT_EQ(response.type, "error");
   ASSERT_THAT(response.error, testing::HasSubstr("parse error"));
 }
+
+TEST(ResponseTest, ParsesVcsHeads) {
+  EXPECT_EQ(aur::VcsHeadResponse(
+                "82e863f0c8a7f3ba1c2e5d7f6b1e0a9d8c7b6a5f\tHEAD\n")
+                .head,
+            "82e863f0c8a7f3ba1c2e5d7f6b1e0a9d8c7b6a5f");
+  EXPECT_EQ(aur::VcsHeadResponse("0123456789ab\n").head, "0123456789ab");
+  EXPECT_EQ(aur::VcsHeadResponse("").head, "");
+  EXPECT_EQ(aur::VcsHeadResponse("\n").head, "");
+}
+
+TEST(ResponseTest, ExtractsRawResults) {
+  std::string_view results;
+  int resultcount = -1;
+
+  aur::RawResponse response(R"({
+    "version": 5,
+    "type": "multiinfo",
+    "resultcount": 2,
+    "results": [ {"Name": "a", "Depends": ["x", "y]"]}, {"Name": "b\"[}"} ]
+  })");
+  ASSERT_TRUE(response.ExtractResults(&results, &resultcount));
+  EXPECT_EQ(resultcount, 2);
+  EXPECT_EQ(results,
+            R"({"Name": "a", "Depends": ["x", "y]"]}, {"Name": "b\"[}"})");
+
+  aur::RawResponse empty(
+      R"({"resultcount":0,"results":[],"type":"multiinfo","version":5})");
+  ASSERT_TRUE(empty.ExtractResults(&results, &resultcount));
+  EXPECT_EQ(resultcount, 0);
+  EXPECT_EQ(results, "");
+
+  for (const auto* bytes : {
+           "",
+           "[]",
+           R"({"resultcount":1})",
+           R"({"resultcount":1,"results":[{"Name":"a"})",
+           R"({"type":"error","resultcount":0,"results":[]})",
+       }) {
+    EXPECT_FALSE(aur::RawResponse(bytes).ExtractResults(&results,
+                                                       &resultcount))
+        << bytes;
+  }
+}
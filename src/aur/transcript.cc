@@ -0,0 +1,154 @@
+#include "transcript.hh"
+
+#include <charconv>
+#include <cstdint>
+#include <sstream>
+
+namespace aur {
+
+// A transcript is a header line followed by one record per exchange:
+//
+//   <url> LF
+//   <status> SP <latency in usec> SP <error size> SP <body size> LF
+//   <error> <body> LF
+//
+// The error and body are stored verbatim, as they may hold anything at all.
+
+namespace {
+
+constexpr std::string_view kHeader = "auracle-transcript 1\n";
+
+bool ConsumeLine(std::string_view* data, std::string_view* line) {
+  const auto eol = data->find('\n');
+  if (eol == data->npos) {
+    return false;
+  }
+
+  *line = data->substr(0, eol);
+  data->remove_prefix(eol + 1);
+  return true;
+}
+
+template <typename T>
+bool ConsumeNumber(std::string_view* data, T* value) {
+  const auto* end = data->data() + data->size();
+  const auto [ptr, ec] = std::from_chars(data->data(), end, *value);
+  if (ec != std::errc()) {
+    return false;
+  }
+
+  data->remove_prefix(ptr - data->data());
+  if (!data->empty() && data->front() == ' ') {
+    data->remove_prefix(1);
+  }
+  return true;
+}
+
+bool ConsumeBytes(std::string_view* data, size_t size, std::string* out) {
+  if (data->size() < size) {
+    return false;
+  }
+
+  out->assign(data->substr(0, size));
+  data->remove_prefix(size);
+  return true;
+}
+
+}  // namespace
+
+bool TranscriptWriter::Open(const std::string& path) {
+  stream_.open(path, std::ofstream::binary | std::ofstream::trunc);
+  if (!stream_.is_open()) {
+    return false;
+  }
+
+  stream_ << kHeader;
+  return true;
+}
+
+void TranscriptWriter::Write(const Exchange& exchange) {
+  stream_ << exchange.url << '\n'
+          << exchange.status << ' ' << exchange.latency.count() << ' '
+          << exchange.error.size() << ' ' << exchange.body.size() << '\n'
+          << exchange.error << exchange.body << '\n';
+
+  // Flush each record, so that a run which is interrupted still leaves behind
+  // everything it saw.
+  stream_.flush();
+}
+
+// static
+std::optional<Transcript> Transcript::Load(const std::string& path,
+                                           std::string* error) {
+  std::ifstream file(path, std::ifstream::binary);
+  if (!file.is_open()) {
+    *error = "failed to open transcript " + path;
+    return std::nullopt;
+  }
+
+  std::stringstream data;
+  data << file.rdbuf();
+
+  auto transcript = Parse(data.str(), error);
+  if (!transcript) {
+    *error = path + ": " + *error;
+  }
+  return transcript;
+}
+
+// static
+std::optional<Transcript> Transcript::Parse(std::string_view data,
+                                            std::string* error) {
+  if (data.substr(0, kHeader.size()) != kHeader) {
+    *error = "not a transcript";
+    return std::nullopt;
+  }
+  data.remove_prefix(kHeader.size());
+
+  Transcript transcript;
+  while (!data.empty()) {
+    Exchange exchange;
+    std::string_view url, sizes;
+    int64_t latency;
+    size_t error_size, body_size;
+
+    if (!ConsumeLine(&data, &url) || !ConsumeLine(&data, &sizes) ||
+        !ConsumeNumber(&sizes, &exchange.status) ||
+        !ConsumeNumber(&sizes, &latency) ||
+        !ConsumeNumber(&sizes, &error_size) ||
+        !ConsumeNumber(&sizes, &body_size) || !sizes.empty() ||
+        !ConsumeBytes(&data, error_size, &exchange.error) ||
+        !ConsumeBytes(&data, body_size, &exchange.body) || data.empty() ||
+        data.front() != '\n') {
+      *error = "truncated or malformed record after " +
+               std::to_string(transcript.size()) + " exchanges";
+      return std::nullopt;
+    }
+    data.remove_prefix(1);
+
+    exchange.url = url;
+    exchange.latency = std::chrono::microseconds(latency);
+    transcript.exchanges_[exchange.url].push_back(std::move(exchange));
+    transcript.size_++;
+  }
+
+  return transcript;
+}
+
+std::optional<Exchange> Transcript::Take(const std::string& url) {
+  auto iter = exchanges_.find(url);
+  if (iter == exchanges_.end()) {
+    return std::nullopt;
+  }
+
+  auto exchange = std::move(iter->second.front());
+  iter->second.pop_front();
+  if (iter->second.empty()) {
+    exchanges_.erase(iter);
+  }
+  size_--;
+
+  return exchange;
+}
+
+}  // namespace aur
@@ -0,0 +1,83 @@
+#ifndef AUR_TRANSCRIPT_HH_
+#define AUR_TRANSCRIPT_HH_
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace aur {
+
+// A single HTTP request and the response it received.
+struct Exchange {
+  std::string url;
+  long status = 0;
+  std::string error;
+  std::string body;
+
+  // How long the response took to arrive, measured from when the transfer was
+  // handed to curl.
+  std::chrono::microseconds latency{0};
+};
+
+// Appends exchanges to a transcript file as they complete.
+class TranscriptWriter {
+ public:
+  TranscriptWriter() = default;
+
+  TranscriptWriter(const TranscriptWriter&) = delete;
+  TranscriptWriter& operator=(const TranscriptWriter&) = delete;
+
+  TranscriptWriter(TranscriptWriter&&) = default;
+  TranscriptWriter& operator=(TranscriptWriter&&) = default;
+
+  // Truncates any existing file at |path|. Returns false if it can't be
+  // opened for writing.
+  bool Open(const std::string& path);
+
+  bool is_open() const { return stream_.is_open(); }
+
+  void Write(const Exchange& exchange);
+
+ private:
+  std::ofstream stream_;
+};
+
+// The exchanges of a previously recorded session, from which responses can be
+// served back without touching the network.
+class Transcript {
+ public:
+  Transcript() = default;
+
+  Transcript(const Transcript&) = delete;
+  Transcript& operator=(const Transcript&) = delete;
+
+  Transcript(Transcript&&) = default;
+  Transcript& operator=(Transcript&&) = default;
+
+  // Returns std::nullopt and fills |error| if the file can't be read, or
+  // doesn't hold a transcript.
+  static std::optional<Transcript> Load(const std::string& path,
+                                        std::string* error);
+
+  // As above, for a transcript which has already been read into memory.
+  static std::optional<Transcript> Parse(std::string_view data,
+                                         std::string* error);
+
+  // Removes and returns the next recorded exchange for |url|. A URL requested
+  // several times is answered in the order its responses were recorded.
+  std::optional<Exchange> Take(const std::string& url);
+
+  size_t size() const { return size_; }
+
+ private:
+  std::unordered_map<std::string, std::deque<Exchange>> exchanges_;
+  size_t size_ = 0;
+};
+
+}  // namespace aur
+
+#endif  // AUR_TRANSCRIPT_HH_
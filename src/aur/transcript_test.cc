@@ -0,0 +1,97 @@
+#include "transcript.hh"
+
+#include <stdlib.h>
+
+#include <filesystem>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+aur::Exchange MakeExchange(std::string url, std::string body) {
+  aur::Exchange exchange;
+  exchange.url = std::move(url);
+  exchange.status = 200;
+  exchange.body = std::move(body);
+  exchange.latency = std::chrono::milliseconds(150);
+  return exchange;
+}
+
+TEST(TranscriptTest, RoundTripsExchanges) {
+  char tmpdir[] = "/tmp/transcript_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = std::string(tmpdir) + "/session";
+
+  {
+    aur::TranscriptWriter writer;
+    ASSERT_TRUE(writer.Open(path));
+    writer.Write(MakeExchange("https://aur/rpc?a", "first\n"));
+    writer.Write(MakeExchange("https://aur/rpc?b", std::string("\0\n\n", 3)));
+
+    auto failed = MakeExchange("https://aur/rpc?a", "");
+    failed.status = 0;
+    failed.error = "Could not resolve host: aur";
+    writer.Write(failed);
+  }
+
+  std::string error;
+  auto transcript = aur::Transcript::Load(path, &error);
+  ASSERT_TRUE(transcript.has_value()) << error;
+  EXPECT_EQ(transcript->size(), 3);
+
+  auto b = transcript->Take("https://aur/rpc?b");
+  ASSERT_TRUE(b.has_value());
+  EXPECT_EQ(b->status, 200);
+  EXPECT_EQ(b->body, std::string("\0\n\n", 3));
+  EXPECT_EQ(b->latency, std::chrono::milliseconds(150));
+  EXPECT_FALSE(transcript->Take("https://aur/rpc?b").has_value());
+
+  // Repeated URLs are answered in the order they were recorded.
+  auto a = transcript->Take("https://aur/rpc?a");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a->body, "first\n");
+  EXPECT_TRUE(a->error.empty());
+
+  a = transcript->Take("https://aur/rpc?a");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a->status, 0);
+  EXPECT_EQ(a->error, "Could not resolve host: aur");
+
+  EXPECT_EQ(transcript->size(), 0);
+
+  std::filesystem::remove_all(tmpdir);
+}
+
+TEST(TranscriptTest, RejectsMalformedTranscripts) {
+  std::string error;
+
+  EXPECT_FALSE(aur::Transcript::Parse("", &error).has_value());
+  EXPECT_EQ(error, "not a transcript");
+
+  EXPECT_TRUE(
+      aur::Transcript::Parse("auracle-transcript 1\n", &error).has_value());
+
+  EXPECT_FALSE(aur::Transcript::Parse("auracle-transcript 1\n"
+                                      "https://aur/rpc\n"
+                                      "200 10 0 10\n"
+                                      "short\n",
+                                      &error)
+                   .has_value());
+  EXPECT_EQ(error, "truncated or malformed record after 0 exchanges");
+
+  EXPECT_FALSE(aur::Transcript::Parse("auracle-transcript 1\n"
+                                      "https://aur/rpc\n"
+                                      "200 ten 0 0\n"
+                                      "\n",
+                                      &error)
+                   .has_value());
+}
+
+TEST(TranscriptTest, FailsToLoadMissingFile) {
+  std::string error;
+  EXPECT_FALSE(
+      aur::Transcript::Load("/nonexistent/transcript", &error).has_value());
+  EXPECT_EQ(error, "failed to open transcript /nonexistent/transcript");
+}
+
+}  // namespace
@@ -1,6 +1,7 @@
 #include "auracle.hh"
 
 #include <cerrno>
+#include <cstring>
 #include <filesystem>
 #include <functional>
 #include <iostream>
@@ -8,10 +9,14 @@
 #include <string_view>
 #include <unordered_set>
 
+#include "aur/profiler.hh"
 #include "aur/response.hh"
 #include "format.hh"
+#include "name_stream.hh"
 #include "pacman.hh"
+#include "result_stream.hh"
 #include "sort.hh"
+#include "vcs.hh"
 
 namespace fs = std::filesystem;
 
@@ -24,54 +29,19 @@ int ErrorNotEnoughArgs() {
   return -EINVAL;
 }
 
-void FormatLong(const std::vector<aur::Package>& packages,
-                const auracle::Pacman* pacman) {
-  for (const auto& p : packages) {
-    format::Long(p, pacman->GetLocalPackage(p.name));
-  }
-}
-
-void FormatNameOnly(const std::vector<aur::Package>& packages) {
-  for (const auto& p : packages) {
-    format::NameOnly(p);
-  }
-}
-
-void FormatShort(const std::vector<aur::Package>& packages,
-                 const auracle::Pacman* pacman) {
-  for (const auto& p : packages) {
-    format::Short(p, pacman->GetLocalPackage(p.name));
-  }
-}
-
-void FormatCustom(const std::vector<aur::Package>& packages,
-                  const std::string& format) {
-  for (const auto& p : packages) {
-    format::Custom(format, p);
-  }
-}
-
-void SortUnique(std::vector<aur::Package>* packages,
-                const sort::Sorter& sorter) {
-  std::sort(packages->begin(), packages->end(), sorter);
-
-  packages->resize(std::unique(packages->begin(), packages->end()) -
-                   packages->begin());
-}
-
 std::vector<std::string> NotFoundPackages(
     const std::vector<std::string>& want, const std::vector<aur::Package>& got,
     const auracle::PackageCache& package_cache) {
+  std::unordered_set<std::string_view> found;
+  found.reserve(got.size());
+  for (const auto& pkg : got) {
+    found.insert(pkg.name);
+  }
+
   std::vector<std::string> missing;
 
   for (const auto& p : want) {
-    if (package_cache.LookupByPkgname(p) != nullptr) {
-      continue;
-    }
-
-    if (std::find_if(got.cbegin(), got.cend(), [&p](const aur::Package& pkg) {
-          return pkg.name == p;
-        }) != got.cend()) {
+    if (found.count(p) > 0 || package_cache.LookupByPkgname(p) != nullptr) {
       continue;
     }
 
@@ -81,6 +51,15 @@ std::vector<std::string> NotFoundPackages(
   return missing;
 }
 
+// How long an observed upstream head for a VCS package is trusted before we
+// go back to the upstream repo.
+constexpr std::chrono::minutes kVcsHeadCacheTtl(10);
+
+// Long lists of names are looked up this many at a time, which usually fits
+// in a single request, with at most this many batches outstanding at once.
+constexpr size_t kInfoBatchSize = 200;
+constexpr int kMaxInfoBatchesInFlight = 4;
+
 std::string_view GetSearchFragment(std::string_view s) {
   static constexpr char kRegexChars[] = "^.+*?$[](){}|\\";
 
@@ -160,12 +139,20 @@ bool RpcResponseIsFailure(
 Auracle::Auracle(Options options)
     : aur_(aur::NewAur(aur::Aur::Options()
                            .set_baseurl(options.aur_baseurl)
-                           .set_useragent("Auracle/" PACKAGE_VERSION))),
-      pacman_(options.pacman) {}
+                           .set_useragent("Auracle/" PACKAGE_VERSION)
+                           .set_unix_socket_path(options.unix_socket)
+                           .set_cache_dir(options.cache_dir))),
+      pacman_(options.pacman),
+      cache_dir_(std::move(options.cache_dir)) {}
+
+void Auracle::WarmUp() { aur_->WarmUp(); }
 
 void Auracle::IteratePackages(std::vector<std::string> args,
                               Auracle::PackageIterator* state) {
+  // Whatever the caller does with these packages waits on this lookup, and
+  // possibly on the lookups of their dependencies after it.
   aur::InfoRequest info_request;
+  info_request.set_priority(aur::Priority::RESOLUTION);
 
   for (const auto& arg : args) {
     if (state->package_cache.LookupByPkgname(arg) != nullptr) {
@@ -191,41 +178,68 @@ void Auracle::IteratePackages(std::vector<std::string> args,
           }
         }
 
-        for (auto& result : results) {
-          // check for the pkgbase existing in our repo
-          const bool have_pkgbase =
-              state->package_cache.LookupByPkgbase(result.pkgbase) != nullptr;
+        IteratePackages(std::move(results), state);
 
-          // Regardless, try to add the package, as it might be another member
-          // of the same pkgbase.
-          auto [p, added] = state->package_cache.AddPackage(std::move(result));
+        return 0;
+      });
+}
 
-          if (!added || have_pkgbase) {
-            continue;
-          }
+void Auracle::IteratePackages(std::vector<aur::Package> packages,
+                              Auracle::PackageIterator* state) {
+  aur::Profiler::Scope scope(aur::Profiler::Phase::RESOLVE);
 
-          if (state->callback) {
-            state->callback(*p);
-          }
+  for (auto& package : packages) {
+    // check for the pkgbase existing in our repo
+    const bool have_pkgbase =
+        state->package_cache.LookupByPkgbase(package.pkgbase) != nullptr;
 
-          if (state->recurse) {
-            std::vector<std::string> alldeps;
-            alldeps.reserve(p->depends.size() + p->makedepends.size() +
-                            p->checkdepends.size());
+    // Regardless, try to add the package, as it might be another member
+    // of the same pkgbase.
+    auto [p, added] = state->package_cache.AddPackage(std::move(package));
 
-            for (const auto* deparray :
-                 {&p->depends, &p->makedepends, &p->checkdepends}) {
-              for (const auto& dep : *deparray) {
-                alldeps.push_back(dep.name);
-              }
-            }
+    if (!added || have_pkgbase) {
+      continue;
+    }
 
-            IteratePackages(std::move(alldeps), state);
-          }
+    if (state->callback) {
+      state->callback(*p);
+    }
+
+    if (state->recurse) {
+      std::vector<std::string> alldeps;
+      alldeps.reserve(p->depends.size() + p->makedepends.size() +
+                      p->checkdepends.size());
+
+      for (const auto* deparray :
+           {&p->depends, &p->makedepends, &p->checkdepends}) {
+        for (const auto& dep : *deparray) {
+          alldeps.push_back(dep.name);
         }
+      }
 
-        return 0;
+      IteratePackages(std::move(alldeps), state);
+    }
+  }
+}
+
+bool Auracle::QueueInfoBatch(NameStream* names,
+                             const aur::Aur::RpcResponseCallback& callback) {
+  std::vector<std::string> batch;
+  if (!names->NextBatch(kInfoBatchSize, &batch)) {
+    return false;
+  }
+
+  aur_->QueueRpcRequest(
+      aur::InfoRequest(batch), [this, names, &callback](
+                                   aur::ResponseWrapper<aur::RpcResponse> r) {
+        const int ret = callback(std::move(r));
+        if (ret == 0) {
+          QueueInfoBatch(names, callback);
+        }
+        return ret;
       });
+
+  return true;
 }
 
 int Auracle::Info(const std::vector<std::string>& args,
@@ -234,38 +248,51 @@ int Auracle::Info(const std::vector<std::string>& args,
     return ErrorNotEnoughArgs();
   }
 
-  std::vector<aur::Package> packages;
-  aur_->QueueRpcRequest(aur::InfoRequest(args),
-                        [&](aur::ResponseWrapper<aur::RpcResponse> response) {
-                          if (RpcResponseIsFailure(response)) {
-                            return -EIO;
-                          }
+  // The default format annotates installed versions, so have the local DB
+  // ready by the time our results come back.
+  if (options.format.empty() && !options.json) {
+    pacman_->LoadInBackground(Pacman::DbScope::LOCAL);
+  }
+
+  ResultStream results(options.sorter, [&](const aur::Package& p) {
+    if (options.json) {
+      format::Json(p);
+    } else if (!options.format.empty()) {
+      format::Custom(options.format, p);
+    } else {
+      format::Long(p, pacman_->GetLocalPackage(p.name));
+    }
+  });
+
+  auto names = NameStream::FromArgs(args);
+  const aur::Aur::RpcResponseCallback callback =
+      [&](aur::ResponseWrapper<aur::RpcResponse> response) {
+        if (RpcResponseIsFailure(response)) {
+          return -EIO;
+        }
+
+        auto packages = std::move(response.value().results);
+        options.filter.Apply(&packages);
 
-                          auto results = response.value().results;
-                          packages.reserve(packages.size() + results.size());
-                          std::move(results.begin(), results.end(),
-                                    std::back_inserter(packages));
+        results.Add(std::move(packages));
+        return 0;
+      };
 
-                          return 0;
-                        });
+  for (int i = 0; i < kMaxInfoBatchesInFlight; ++i) {
+    if (!QueueInfoBatch(&names, callback)) {
+      break;
+    }
+  }
 
   auto r = aur_->Wait();
   if (r < 0) {
     return r;
   }
 
-  if (packages.empty()) {
-    return -ENOENT;
-  }
-
-  // It's unlikely, but still possible that the results may not be unique when
-  // our query is large enough that it needs to be split into multiple requests.
-  SortUnique(&packages, options.sorter);
+  results.Finish();
 
-  if (!options.format.empty()) {
-    FormatCustom(packages, options.format);
-  } else {
-    FormatLong(packages, pacman_);
+  if (results.empty()) {
+    return -ENOENT;
   }
 
   return 0;
@@ -288,6 +315,7 @@ int Auracle::Search(const std::vector<std::string>& args,
   }
 
   const auto matches = [&patterns, &options](const aur::Package& p) {
+    aur::Profiler::Scope scope(aur::Profiler::Phase::FILTER);
     return std::all_of(patterns.begin(), patterns.end(),
                        [&p, &options](const std::regex& re) {
                          switch (options.search_by) {
@@ -305,7 +333,22 @@ int Auracle::Search(const std::vector<std::string>& args,
                        });
   };
 
-  std::vector<aur::Package> packages;
+  if (options.format.empty() && !options.quiet && !options.json) {
+    pacman_->LoadInBackground(Pacman::DbScope::LOCAL);
+  }
+
+  ResultStream results(options.sorter, [&](const aur::Package& p) {
+    if (options.json) {
+      format::Json(p);
+    } else if (!options.format.empty()) {
+      format::Custom(options.format, p);
+    } else if (options.quiet) {
+      format::NameOnly(p);
+    } else {
+      format::Short(p, pacman_->GetLocalPackage(p.name));
+    }
+  });
+
   for (const auto& arg : args) {
     std::string_view frag = arg;
     if (options.allow_regex) {
@@ -323,11 +366,18 @@ int Auracle::Search(const std::vector<std::string>& args,
                               return -EIO;
                             }
 
-                            auto results = response.value().results;
-                            std::copy_if(
-                                std::make_move_iterator(results.begin()),
-                                std::make_move_iterator(results.end()),
-                                std::back_inserter(packages), matches);
+                            auto packages =
+                                std::move(response.value().results);
+                            packages.erase(
+                                std::remove_if(
+                                    packages.begin(), packages.end(),
+                                    [&matches](const aur::Package& p) {
+                                      return !matches(p);
+                                    }),
+                                packages.end());
+                            options.filter.Apply(&packages);
+
+                            results.Add(std::move(packages));
                             return 0;
                           });
   }
@@ -337,15 +387,7 @@ int Auracle::Search(const std::vector<std::string>& args,
     return r;
   }
 
-  SortUnique(&packages, options.sorter);
-
-  if (!options.format.empty()) {
-    FormatCustom(packages, options.format);
-  } else if (options.quiet) {
-    FormatNameOnly(packages);
-  } else {
-    FormatShort(packages, pacman_);
-  }
+  results.Finish();
 
   return 0;
 }
@@ -378,7 +420,9 @@ int Auracle::Clone(const std::vector<std::string>& args,
         });
   });
 
-  IteratePackages(args, &iter);
+  // Recursing needs every package on hand anyway, so there's nothing to gain
+  // from reading names a batch at a time here.
+  IteratePackages(NameStream::FromArgs(args).ReadAll(), &iter);
 
   int r = aur_->Wait();
   if (r < 0) {
@@ -464,6 +508,8 @@ int Auracle::BuildOrder(const std::vector<std::string>& args,
     return ErrorNotEnoughArgs();
   }
 
+  pacman_->LoadInBackground(Pacman::DbScope::ALL);
+
   PackageIterator iter(/* recurse = */ true, nullptr);
   IteratePackages(args, &iter);
 
@@ -478,16 +524,20 @@ int Auracle::BuildOrder(const std::vector<std::string>& args,
 
   std::vector<std::pair<std::string, const aur::Package*>> total_ordering;
   std::unordered_set<std::string> seen;
-  for (const auto& arg : args) {
-    iter.package_cache.WalkDependencies(
-        arg, [&total_ordering, &seen](const std::string& pkgname,
-                                      const aur::Package* package) {
-          if (seen.emplace(pkgname).second) {
-            total_ordering.emplace_back(pkgname, package);
-          }
-        });
+  {
+    aur::Profiler::Scope scope(aur::Profiler::Phase::RESOLVE);
+    for (const auto& arg : args) {
+      iter.package_cache.WalkDependencies(
+          arg, [&total_ordering, &seen](const std::string& pkgname,
+                                        const aur::Package* package) {
+            if (seen.emplace(pkgname).second) {
+              total_ordering.emplace_back(pkgname, package);
+            }
+          });
+    }
   }
 
+  aur::Profiler::Scope scope(aur::Profiler::Phase::FORMAT);
   for (const auto& [name, pkg] : total_ordering) {
     const bool satisfied = pacman_->DependencyIsSatisfied(name);
     const bool from_aur = pkg != nullptr;
@@ -531,7 +581,7 @@ int Auracle::Update(const std::vector<std::string>& args,
   }
 
   std::vector<aur::Package> packages;
-  auto r = GetOutdatedPackages(args, &packages);
+  auto r = GetOutdatedPackages(args, options.devel, &packages);
   if (r < 0) {
     return r;
   }
@@ -558,56 +608,153 @@ int Auracle::Update(const std::vector<std::string>& args,
         });
   });
 
-  std::vector<std::string> outdated;
-  outdated.reserve(packages.size());
-  for (const auto& p : packages) {
-    outdated.push_back(p.name);
-  }
-
-  IteratePackages(outdated, &iter);
+  // We already hold the full package info for everything that's outdated, so
+  // seed the iterator directly rather than asking the AUR for it again.
+  IteratePackages(std::move(packages), &iter);
 
   return aur_->Wait();
 }
 
 int Auracle::GetOutdatedPackages(const std::vector<std::string>& args,
+                                 bool devel,
                                  std::vector<aur::Package>* packages) {
   aur::InfoRequest info_request;
 
-  auto local_pkgs = pacman_->LocalPackages();
-  for (const auto& pkg : local_pkgs) {
-    if (args.empty() ||
-        std::find(args.cbegin(), args.cend(), pkg.pkgname) != args.cend()) {
+  // Only foreign packages can possibly come from the AUR. Packages which are
+  // explicitly named are checked even if pacman would ignore them.
+  const auto foreign_pkgs =
+      pacman_->ForeignPackages(/* include_ignored = */ !args.empty());
+
+  // Names which aren't foreign packages are of no interest, so only those that
+  // are need to be remembered, however many names we're given.
+  std::unordered_set<std::string> wanted;
+  if (!args.empty()) {
+    std::unordered_set<std::string_view> foreign;
+    for (const auto& pkg : foreign_pkgs) {
+      foreign.insert(pkg.pkgname);
+    }
+
+    auto names = NameStream::FromArgs(args);
+    std::vector<std::string> batch;
+    while (names.NextBatch(kInfoBatchSize, &batch)) {
+      for (auto& name : batch) {
+        if (foreign.count(name) > 0) {
+          wanted.insert(std::move(name));
+        }
+      }
+    }
+  }
+
+  for (const auto& pkg : foreign_pkgs) {
+    if (args.empty() || wanted.count(pkg.pkgname) > 0) {
       info_request.AddArg(pkg.pkgname);
     }
   }
 
+  const auto vcs_cache_path = fs::path(cache_dir_) / "vcs-heads";
+  VcsHeadCache vcs_cache(kVcsHeadCacheTtl);
+  if (devel && !cache_dir_.empty()) {
+    vcs_cache.Load(vcs_cache_path);
+  }
+
   aur_->QueueRpcRequest(
       info_request, [&](aur::ResponseWrapper<aur::RpcResponse> response) {
         if (RpcResponseIsFailure(response)) {
           return -EIO;
         }
 
-        auto results = response.value().results;
-        std::copy_if(std::make_move_iterator(results.begin()),
-                     std::make_move_iterator(results.end()),
-                     std::back_inserter(*packages), [&](const aur::Package& p) {
-                       auto local = pacman_->GetLocalPackage(p.name);
+        aur::Profiler::Scope scope(aur::Profiler::Phase::RESOLVE);
+        for (auto& p : response.value().results) {
+          auto local = pacman_->GetLocalPackage(p.name);
+          if (!local) {
+            continue;
+          }
 
-                       return local &&
-                              Pacman::Vercmp(p.version, local->pkgver) > 0;
-                     });
+          if (Pacman::Vercmp(p.version, local->pkgver) > 0) {
+            packages->push_back(std::move(p));
+          } else if (devel && IsVcsPackage(p.name)) {
+            CheckVcsPackage(std::move(p), std::move(local->pkgver), &vcs_cache,
+                            packages);
+          }
+        }
 
         return 0;
       });
 
-  return aur_->Wait();
+  auto r = aur_->Wait();
+
+  if (devel && !cache_dir_.empty()) {
+    vcs_cache.Save(vcs_cache_path, VcsHeadCache::Clock::now());
+  }
+
+  return r;
+}
+
+void Auracle::CheckVcsPackage(aur::Package package, std::string local_version,
+                              VcsHeadCache* vcs_cache,
+                              std::vector<aur::Package>* packages) {
+  const auto on_head = [package, local_version, packages](
+                           const VcsSource& source, const std::string& head) {
+    if (UpstreamHasMoved(source.vcs, local_version, head).value_or(false)) {
+      packages->push_back(package);
+    }
+  };
+
+  // The .SRCINFO is only read to find the upstream repository, which makes it
+  // metadata rather than content.
+  auto srcinfo_request = aur::RawRequest::ForSourceFile(package, ".SRCINFO");
+  srcinfo_request.set_priority(aur::Priority::METADATA);
+
+  aur_->QueueRawRequest(
+      srcinfo_request, [this, pkgname{package.name}, vcs_cache, on_head](
+                           aur::ResponseWrapper<aur::RawResponse> response) {
+        if (!response.ok() || response.status() != 200) {
+          std::cerr << "warning: failed to fetch .SRCINFO for " << pkgname
+                    << "\n";
+          return 0;
+        }
+
+        // By convention, the pkgver of a VCS package describes its first
+        // source.
+        const auto sources = ParseVcsSources(response.value().bytes);
+        if (sources.empty()) {
+          return 0;
+        }
+        const auto& source = sources[0];
+
+        const auto now = VcsHeadCache::Clock::now();
+        if (auto head = vcs_cache->Lookup(source, now)) {
+          on_head(source, *head);
+          return 0;
+        }
+
+        aur_->QueueVcsHeadRequest(
+            aur::VcsHeadRequest(source.vcs, source.url, source.ref),
+            [pkgname, source, vcs_cache, on_head](
+                aur::ResponseWrapper<aur::VcsHeadResponse> response) {
+              if (!response.ok()) {
+                std::cerr << "warning: failed to check upstream for "
+                          << pkgname << ": " << response.error() << "\n";
+                return 0;
+              }
+
+              const auto& head = response.value().head;
+              if (!head.empty()) {
+                vcs_cache->Store(source, head, VcsHeadCache::Clock::now());
+              }
+              on_head(source, head);
+              return 0;
+            });
+
+        return 0;
+      });
 }
 
 int Auracle::Outdated(const std::vector<std::string>& args,
                       const CommandOptions& options) {
   std::vector<aur::Package> packages;
 
-  auto r = GetOutdatedPackages(args, &packages);
+  auto r = GetOutdatedPackages(args, options.devel, &packages);
   if (r < 0) {
     return r;
   }
@@ -617,9 +764,13 @@ int Auracle::Outdated(const std::vector<std::string>& args,
   }
 
   // Not strictly needed, but let's keep output order stable
-  std::sort(packages.begin(), packages.end(),
-            sort::MakePackageSorter("name", sort::OrderBy::ORDER_ASC));
+  {
+    aur::Profiler::Scope scope(aur::Profiler::Phase::SORT);
+    std::sort(packages.begin(), packages.end(),
+              sort::MakePackageSorter("name", sort::OrderBy::ORDER_ASC));
+  }
 
+  aur::Profiler::Scope scope(aur::Profiler::Phase::FORMAT);
   for (const auto& r : packages) {
     if (options.quiet) {
       format::NameOnly(r);
@@ -629,6 +780,8 @@ int Auracle::Outdated(const std::vector<std::string>& args,
     }
   }
 
+  format::Flush();
+
   return 0;
 }
 
@@ -658,9 +811,50 @@ int Auracle::RawSearch(const std::vector<std::string>& args,
 
 int Auracle::RawInfo(const std::vector<std::string>& args,
                      const CommandOptions&) {
-  aur_->QueueRawRequest(aur::InfoRequest(args), &RawSearchDone);
+  // Large queries are split across several requests. Rather than printing a
+  // document for each, splice their results into a single document. Nothing
+  // is written until every request has succeeded, so that a failure never
+  // leaves a truncated document behind. The resultcount isn't known until the
+  // end, so it goes last.
+  int resultcount = 0;
+  std::string spliced;
 
-  return aur_->Wait();
+  aur_->QueueRawRequest(
+      aur::InfoRequest(args),
+      [&](aur::ResponseWrapper<aur::RawResponse> response) {
+        if (!response.ok()) {
+          std::cerr << "error: request failed: " << response.error() << "\n";
+          return -EIO;
+        }
+
+        std::string_view results;
+        int count;
+        if (!response.value().ExtractResults(&results, &count)) {
+          std::cerr << "error: unexpected response from AUR: "
+                    << response.value().bytes << "\n";
+          return -EIO;
+        }
+
+        if (!results.empty()) {
+          if (!spliced.empty()) {
+            spliced.push_back(',');
+          }
+          spliced.append(results);
+        }
+        resultcount += count;
+
+        return 0;
+      });
+
+  auto r = aur_->Wait();
+  if (r < 0) {
+    return r;
+  }
+
+  std::cout << R"({"version":5,"type":"multiinfo","results":[)" << spliced
+            << R"(],"resultcount":)" << resultcount << "}\n";
+
+  return 0;
 }
 
 }  // namespace auracle
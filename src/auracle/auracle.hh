@@ -5,9 +5,13 @@
 #include <vector>
 
 #include "aur/aur.hh"
+#include "filter.hh"
+#include "format.hh"
+#include "name_stream.hh"
 #include "package_cache.hh"
 #include "pacman.hh"
 #include "sort.hh"
+#include "vcs.hh"
 
 namespace auracle {
 
@@ -19,6 +23,11 @@ class Auracle {
       return *this;
     }
 
+    Options& set_unix_socket(std::string unix_socket) {
+      this->unix_socket = std::move(unix_socket);
+      return *this;
+    }
+
     Options& set_pacman(Pacman* pacman) {
       this->pacman = pacman;
       return *this;
@@ -29,9 +38,16 @@ class Auracle {
       return *this;
     }
 
+    Options& set_cache_dir(std::string cache_dir) {
+      this->cache_dir = std::move(cache_dir);
+      return *this;
+    }
+
     std::string aur_baseurl;
+    std::string unix_socket;
     Pacman* pacman = nullptr;
     bool quiet = false;
+    std::string cache_dir;
   };
 
   explicit Auracle(Options options);
@@ -44,17 +60,26 @@ class Auracle {
   Auracle(Auracle&&) = default;
   Auracle& operator=(Auracle&&) = default;
 
+  // Starts connecting to the AUR ahead of the first command, so that the
+  // connection comes up while the command does its local work. Pacman may
+  // be supplied afterwards with set_pacman(), as only commands need it.
+  void WarmUp();
+  void set_pacman(Pacman* pacman) { pacman_ = pacman; }
+
   struct CommandOptions {
     aur::SearchRequest::SearchBy search_by =
         aur::SearchRequest::SearchBy::NAME_DESC;
     std::string directory;
     bool recurse = false;
+    bool devel = false;
     bool allow_regex = true;
     bool quiet = false;
+    bool json = false;
     std::string show_file = "PKGBUILD";
     sort::Sorter sorter =
         sort::MakePackageSorter("name", sort::OrderBy::ORDER_ASC);
-    std::string format;
+    ::format::Template format;
+    Filter filter;
   };
 
   int BuildOrder(const std::vector<std::string>& args,
@@ -87,13 +112,33 @@ class Auracle {
     PackageCache package_cache;
   };
 
-  int GetOutdatedPackages(const std::vector<std::string>& args,
+  int GetOutdatedPackages(const std::vector<std::string>& args, bool devel,
                           std::vector<aur::Package>* packages);
 
+  // Checks whether the upstream repo of a VCS package has moved beyond the
+  // locally installed version, adding it to |packages| if so.
+  void CheckVcsPackage(aur::Package package, std::string local_version,
+                       VcsHeadCache* vcs_cache,
+                       std::vector<aur::Package>* packages);
+
+  // Queues an info request for the next batch of |names|, which queues the
+  // batch after it once |callback| has handled the response. Returns false if
+  // there were no names left. Both arguments must outlive the next Wait().
+  bool QueueInfoBatch(NameStream* names,
+                      const aur::Aur::RpcResponseCallback& callback);
+
+  // Fetches info for the given package names and feeds the results to the
+  // iterator.
   void IteratePackages(std::vector<std::string> args, PackageIterator* state);
 
+  // Feeds packages which have already been fetched to the iterator, queueing
+  // requests only for dependencies when the iterator recurses.
+  void IteratePackages(std::vector<aur::Package> packages,
+                       PackageIterator* state);
+
   std::unique_ptr<aur::Aur> aur_;
   Pacman* pacman_;
+  std::string cache_dir_;
 };
 
 }  // namespace auracle
@@ -0,0 +1,121 @@
+// Exercises the paths that scale with the number of names given to info and
+// outdated. Every stage here should be linear (or n log n where sorting is
+// asked for), so the 100k cases should take roughly ten times as long as the
+// 10k cases. Run with `meson test --benchmark`; gtest reports the timings.
+
+#include <string>
+#include <vector>
+
+#include "aur/request.hh"
+#include "gtest/gtest.h"
+#include "package_cache.hh"
+#include "pacman_index.hh"
+#include "result_stream.hh"
+#include "sort.hh"
+
+namespace {
+
+std::string NameFor(int i) { return "package-" + std::to_string(i); }
+
+std::vector<std::string> MakeNames(int count) {
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    names.push_back(NameFor(i));
+  }
+  return names;
+}
+
+aur::Package MakePackage(int i) {
+  aur::Package p;
+  p.package_id = i + 1;
+  p.pkgbase_id = i + 1;
+  p.name = NameFor(i);
+  p.pkgbase = p.name;
+  p.version = std::to_string(i % 97) + "." + std::to_string(i % 13) + "-1";
+  p.votes = i % 1000;
+  return p;
+}
+
+class BatchBenchmark : public testing::TestWithParam<int> {};
+
+TEST_P(BatchBenchmark, BuildsInfoRequests) {
+  const auto names = MakeNames(GetParam());
+
+  aur::InfoRequest request(names);
+  const auto urls = request.Build("https://aur.archlinux.org");
+
+  size_t args = 0;
+  for (const auto& url : urls) {
+    for (auto pos = url.find("arg[]="); pos != url.npos;
+         pos = url.find("arg[]=", pos + 1)) {
+      ++args;
+    }
+  }
+  EXPECT_EQ(args, names.size());
+}
+
+TEST_P(BatchBenchmark, CachesPackages) {
+  auracle::PackageCache cache;
+  for (int i = 0; i < GetParam(); ++i) {
+    cache.AddPackage(MakePackage(i));
+  }
+
+  // Adding everything again finds the existing entries.
+  for (int i = 0; i < GetParam(); ++i) {
+    ASSERT_FALSE(cache.AddPackage(MakePackage(i)).second);
+  }
+
+  for (const auto& name : MakeNames(GetParam())) {
+    ASSERT_NE(cache.LookupByPkgname(name), nullptr);
+  }
+  EXPECT_EQ(cache.size(), GetParam());
+}
+
+TEST_P(BatchBenchmark, MergesSortedResults) {
+  int printed = 0;
+  auracle::ResultStream stream(
+      sort::MakePackageSorter("version", sort::OrderBy::ORDER_DESC),
+      [&printed](const aur::Package&) { ++printed; });
+
+  // Split the way the AUR splits a long info request, with some overlap.
+  constexpr int kPerResponse = 150;
+  for (int begin = 0; begin < GetParam(); begin += kPerResponse) {
+    std::vector<aur::Package> response;
+    for (int i = std::max(0, begin - 10);
+         i < std::min(GetParam(), begin + kPerResponse); ++i) {
+      response.push_back(MakePackage(i));
+    }
+    stream.Add(std::move(response));
+  }
+  stream.Finish();
+
+  EXPECT_EQ(printed, GetParam());
+}
+
+TEST_P(BatchBenchmark, FindsLocalPackages) {
+  auracle::PacmanIndex::Builder builder({
+      {"local", "/var/lib/pacman/local", 0, 0},
+      {"core", "/var/lib/pacman/sync/core.db", 0, 0},
+  });
+  for (int i = 0; i < GetParam(); ++i) {
+    const auto p = MakePackage(i);
+    builder.AddPackage(i % 2, p.name, p.version, {});
+  }
+
+  const auto index = auracle::PacmanIndex::FromBytes(builder.Serialize());
+  ASSERT_NE(index, nullptr);
+
+  int foreign = 0;
+  for (const auto& p : index->Packages(0)) {
+    foreign += !index->FindPackage(1, p.name).has_value();
+  }
+  EXPECT_EQ(foreign, (GetParam() + 1) / 2);
+}
+
+INSTANTIATE_TEST_CASE_P(Names, BatchBenchmark, testing::Values(10000, 100000),
+                        [](const auto& info) {
+                          return std::to_string(info.param / 1000) + "k";
+                        });
+
+}  // namespace
@@ -0,0 +1,436 @@
+#include "filter.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+#include "aur/profiler.hh"
+
+namespace auracle {
+
+namespace {
+
+enum class Column : short {
+  VOTES,
+  POPULARITY,
+  SUBMITTED,
+  MODIFIED,
+  OUTOFDATE,
+  ORPHAN,
+};
+
+enum class Op : short { EQ, NE, LT, LE, GT, GE };
+
+struct ColumnInfo {
+  std::string_view name;
+  Column column;
+  bool is_timestamp;
+  bool is_flag;
+};
+
+constexpr ColumnInfo kColumns[] = {
+    {"votes", Column::VOTES, false, false},
+    {"popularity", Column::POPULARITY, false, false},
+    {"submitted", Column::SUBMITTED, true, false},
+    {"modified", Column::MODIFIED, true, false},
+    {"outofdate", Column::OUTOFDATE, true, true},
+    {"orphan", Column::ORPHAN, false, true},
+};
+
+// The <cctype> classifiers are undefined for negative values, which is what
+// bytes outside of ASCII are as a plain char.
+bool IsSpace(char c) { return std::isspace(static_cast<unsigned char>(c)); }
+bool IsAlpha(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
+bool IsDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+template <typename T, typename Cmp>
+void CompareKernel(const std::vector<T>& column, double value, Cmp cmp,
+                   uint8_t* out) {
+  const size_t n = column.size();
+  const T* in = column.data();
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = cmp(static_cast<double>(in[i]), value);
+  }
+}
+
+template <typename T>
+void Compare(const std::vector<T>& column, Op op, double value,
+             uint8_t* out) {
+  switch (op) {
+    case Op::EQ:
+      return CompareKernel(column, value, std::equal_to<double>(), out);
+    case Op::NE:
+      return CompareKernel(column, value, std::not_equal_to<double>(), out);
+    case Op::LT:
+      return CompareKernel(column, value, std::less<double>(), out);
+    case Op::LE:
+      return CompareKernel(column, value, std::less_equal<double>(), out);
+    case Op::GT:
+      return CompareKernel(column, value, std::greater<double>(), out);
+    case Op::GE:
+      return CompareKernel(column, value, std::greater_equal<double>(), out);
+  }
+}
+
+}  // namespace
+
+PackageColumns::PackageColumns(const std::vector<aur::Package>& packages) {
+  const size_t n = packages.size();
+  votes.reserve(n);
+  popularity.reserve(n);
+  submitted.reserve(n);
+  modified.reserve(n);
+  outofdate.reserve(n);
+  orphan.reserve(n);
+
+  for (const auto& p : packages) {
+    votes.push_back(p.votes);
+    popularity.push_back(p.popularity);
+    submitted.push_back(p.submitted.count());
+    modified.push_back(p.modified.count());
+    outofdate.push_back(p.out_of_date.count());
+    orphan.push_back(p.maintainer.empty());
+  }
+}
+
+struct Filter::Node {
+  enum class Kind : short { AND, OR, NOT, COMPARE, FLAG };
+
+  Kind kind;
+  std::unique_ptr<Node> lhs;
+  std::unique_ptr<Node> rhs;
+
+  Column column = Column::VOTES;
+  Op op = Op::EQ;
+  double value = 0;
+};
+
+// A recursive descent parser for the grammar:
+//
+//   or      := and ('||' and)*
+//   and     := unary ('&&' unary)*
+//   unary   := '!' unary | '(' or ')' | FIELD OP VALUE | FLAG
+class Filter::Parser {
+ public:
+  Parser(std::string_view expr, Clock::time_point now, std::string* error)
+      : expr_(expr), now_(now), error_(error) {}
+
+  std::unique_ptr<Node> Parse() {
+    auto node = ParseOr();
+    if (node == nullptr) {
+      return nullptr;
+    }
+
+    SkipSpace();
+    if (pos_ < expr_.size()) {
+      return Fail("unexpected '" + std::string(expr_.substr(pos_)) + "'");
+    }
+
+    return node;
+  }
+
+ private:
+  void SkipSpace() {
+    while (pos_ < expr_.size() && IsSpace(expr_[pos_])) {
+      ++pos_;
+    }
+  }
+
+  bool Consume(std::string_view token) {
+    SkipSpace();
+    if (expr_.substr(pos_, token.size()) != token) {
+      return false;
+    }
+    pos_ += token.size();
+    return true;
+  }
+
+  std::unique_ptr<Node> Fail(std::string message) {
+    if (error_->empty()) {
+      *error_ = std::move(message);
+    }
+    return nullptr;
+  }
+
+  static std::unique_ptr<Node> MakeNode(Node::Kind kind,
+                                        std::unique_ptr<Node> lhs,
+                                        std::unique_ptr<Node> rhs = nullptr) {
+    auto node = std::make_unique<Node>();
+    node->kind = kind;
+    node->lhs = std::move(lhs);
+    node->rhs = std::move(rhs);
+    return node;
+  }
+
+  std::unique_ptr<Node> ParseOr() {
+    auto lhs = ParseAnd();
+    while (lhs != nullptr && Consume("||")) {
+      auto rhs = ParseAnd();
+      if (rhs == nullptr) {
+        return nullptr;
+      }
+      lhs = MakeNode(Node::Kind::OR, std::move(lhs), std::move(rhs));
+    }
+    return lhs;
+  }
+
+  std::unique_ptr<Node> ParseAnd() {
+    auto lhs = ParseUnary();
+    while (lhs != nullptr && Consume("&&")) {
+      auto rhs = ParseUnary();
+      if (rhs == nullptr) {
+        return nullptr;
+      }
+      lhs = MakeNode(Node::Kind::AND, std::move(lhs), std::move(rhs));
+    }
+    return lhs;
+  }
+
+  std::unique_ptr<Node> ParseUnary() {
+    // Don't mistake != for negation.
+    SkipSpace();
+    if (expr_.substr(pos_, 2) != "!=" && Consume("!")) {
+      auto operand = ParseUnary();
+      if (operand == nullptr) {
+        return nullptr;
+      }
+      return MakeNode(Node::Kind::NOT, std::move(operand));
+    }
+
+    if (Consume("(")) {
+      auto node = ParseOr();
+      if (node != nullptr && !Consume(")")) {
+        return Fail("missing ')'");
+      }
+      return node;
+    }
+
+    return ParseTerm();
+  }
+
+  std::unique_ptr<Node> ParseTerm() {
+    SkipSpace();
+    const auto start = pos_;
+    while (pos_ < expr_.size() && IsAlpha(expr_[pos_])) {
+      ++pos_;
+    }
+    const auto name = expr_.substr(start, pos_ - start);
+    if (name.empty()) {
+      return Fail(pos_ < expr_.size() ? "expected field name"
+                                      : "unexpected end of expression");
+    }
+
+    const auto info =
+        std::find_if(std::begin(kColumns), std::end(kColumns),
+                     [name](const ColumnInfo& c) { return c.name == name; });
+    if (info == std::end(kColumns)) {
+      return Fail("unknown field '" + std::string(name) + "'");
+    }
+
+    auto node = std::make_unique<Node>();
+    node->column = info->column;
+
+    const auto op = ParseOp();
+    if (!op) {
+      if (!info->is_flag) {
+        return Fail("expected comparison after '" + std::string(name) + "'");
+      }
+      node->kind = Node::Kind::FLAG;
+      return node;
+    }
+
+    if (info->column == Column::ORPHAN) {
+      return Fail("'orphan' can't be compared");
+    }
+
+    node->kind = Node::Kind::COMPARE;
+    node->op = *op;
+    if (!ParseValue(info->is_timestamp, &node->value)) {
+      return Fail("invalid value for '" + std::string(name) + "'");
+    }
+
+    return node;
+  }
+
+  std::optional<Op> ParseOp() {
+    // Longest operators first, so that <= isn't taken as <.
+    static constexpr std::pair<std::string_view, Op> kOps[] = {
+        {"==", Op::EQ}, {"!=", Op::NE}, {"<=", Op::LE},
+        {">=", Op::GE}, {"<", Op::LT},  {">", Op::GT},
+    };
+
+    for (const auto& [token, op] : kOps) {
+      if (Consume(token)) {
+        return op;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  bool ParseValue(bool is_timestamp, double* value) {
+    SkipSpace();
+    const char* begin = expr_.data() + pos_;
+    const char* end = expr_.data() + expr_.size();
+
+    // std::from_chars for doubles isn't universally available yet.
+    const char* p = begin;
+    while (p < end && (IsDigit(*p) || *p == '.')) {
+      ++p;
+    }
+    if (p == begin) {
+      return false;
+    }
+
+    try {
+      *value = std::stod(std::string(begin, p));
+    } catch (const std::exception&) {
+      return false;
+    }
+    pos_ += p - begin;
+
+    if (pos_ == expr_.size() || !IsAlpha(expr_[pos_])) {
+      return true;
+    }
+
+    if (!is_timestamp) {
+      return false;
+    }
+
+    static constexpr std::pair<char, int64_t> kUnits[] = {
+        {'s', 1},     {'m', 60},        {'h', 3600},
+        {'d', 86400}, {'w', 7 * 86400}, {'y', 365 * 86400},
+    };
+
+    const auto unit =
+        std::find_if(std::begin(kUnits), std::end(kUnits),
+                     [c = expr_[pos_]](const auto& u) { return u.first == c; });
+    if (unit == std::end(kUnits)) {
+      return false;
+    }
+    ++pos_;
+
+    const auto seconds_ago = *value * unit->second;
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        now_.time_since_epoch());
+    *value = now.count() - seconds_ago;
+    return true;
+  }
+
+  std::string_view expr_;
+  size_t pos_ = 0;
+  Clock::time_point now_;
+  std::string* error_;
+};
+
+// static
+std::optional<Filter> Filter::Parse(std::string_view expr,
+                                    Clock::time_point now,
+                                    std::string* error) {
+  error->clear();
+
+  auto root = Parser(expr, now, error).Parse();
+  if (root == nullptr) {
+    return std::nullopt;
+  }
+
+  Filter filter;
+  filter.root_ = std::move(root);
+  return filter;
+}
+
+std::vector<uint8_t> Filter::Evaluate(const PackageColumns& columns) const {
+  std::vector<uint8_t> matches(columns.size(), 1);
+  if (root_ != nullptr) {
+    EvaluateNode(*root_, columns, &matches);
+  }
+  return matches;
+}
+
+void Filter::Apply(std::vector<aur::Package>* packages) const {
+  if (empty() || packages->empty()) {
+    return;
+  }
+
+  aur::Profiler::Scope scope(aur::Profiler::Phase::FILTER);
+  const auto matches = Evaluate(PackageColumns(*packages));
+
+  size_t kept = 0;
+  for (size_t i = 0; i < packages->size(); ++i) {
+    if (matches[i]) {
+      if (kept != i) {
+        (*packages)[kept] = std::move((*packages)[i]);
+      }
+      ++kept;
+    }
+  }
+  packages->resize(kept);
+}
+
+// static
+void Filter::EvaluateNode(const Node& node, const PackageColumns& columns,
+                          std::vector<uint8_t>* out) {
+  using Kind = Node::Kind;
+
+  const size_t n = columns.size();
+  uint8_t* o = out->data();
+
+  switch (node.kind) {
+    case Kind::AND:
+    case Kind::OR: {
+      std::vector<uint8_t> rhs(n);
+      EvaluateNode(*node.lhs, columns, out);
+      EvaluateNode(*node.rhs, columns, &rhs);
+
+      const uint8_t* r = rhs.data();
+      if (node.kind == Kind::AND) {
+        for (size_t i = 0; i < n; ++i) {
+          o[i] &= r[i];
+        }
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          o[i] |= r[i];
+        }
+      }
+      break;
+    }
+    case Kind::NOT:
+      EvaluateNode(*node.lhs, columns, out);
+      for (size_t i = 0; i < n; ++i) {
+        o[i] = !o[i];
+      }
+      break;
+    case Kind::FLAG:
+      if (node.column == Column::ORPHAN) {
+        std::copy(columns.orphan.begin(), columns.orphan.end(), o);
+      } else {
+        for (size_t i = 0; i < n; ++i) {
+          o[i] = columns.outofdate[i] != 0;
+        }
+      }
+      break;
+    case Kind::COMPARE:
+      switch (node.column) {
+        case Column::VOTES:
+          Compare(columns.votes, node.op, node.value, o);
+          break;
+        case Column::POPULARITY:
+          Compare(columns.popularity, node.op, node.value, o);
+          break;
+        case Column::SUBMITTED:
+          Compare(columns.submitted, node.op, node.value, o);
+          break;
+        case Column::MODIFIED:
+          Compare(columns.modified, node.op, node.value, o);
+          break;
+        case Column::OUTOFDATE:
+          Compare(columns.outofdate, node.op, node.value, o);
+          break;
+        case Column::ORPHAN:
+          break;
+      }
+      break;
+  }
+}
+
+}  // namespace auracle
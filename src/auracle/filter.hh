@@ -0,0 +1,73 @@
+#ifndef AURACLE_FILTER_HH_
+#define AURACLE_FILTER_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aur/package.hh"
+
+namespace auracle {
+
+// The filterable attributes of a set of packages, stored column-wise so that
+// a filter can be evaluated one column at a time in tight loops.
+struct PackageColumns {
+  explicit PackageColumns(const std::vector<aur::Package>& packages);
+
+  size_t size() const { return votes.size(); }
+
+  std::vector<int64_t> votes;
+  std::vector<double> popularity;
+  std::vector<int64_t> submitted;
+  std::vector<int64_t> modified;
+  std::vector<int64_t> outofdate;
+  std::vector<uint8_t> orphan;
+};
+
+// A boolean expression over package attributes, e.g.
+//
+//   votes > 50 && !outofdate && modified > 1y
+//
+// Comparisons take the form FIELD OP VALUE, where FIELD is one of votes,
+// popularity, submitted, modified, or outofdate, and OP is one of ==, !=, <,
+// <=, >, or >=. Timestamp fields may be compared against a duration such as
+// 30d, which stands for the point in time that long ago (units are s, m, h,
+// d, w, and y). The flags outofdate and orphan may be used on their own.
+// Terms combine with !, &&, ||, and parentheses.
+class Filter {
+ public:
+  using Clock = std::chrono::system_clock;
+
+  Filter() = default;
+
+  // Returns std::nullopt and fills |error| if the expression isn't valid.
+  // Durations are resolved relative to |now|.
+  static std::optional<Filter> Parse(std::string_view expr,
+                                     Clock::time_point now,
+                                     std::string* error);
+
+  bool empty() const { return root_ == nullptr; }
+
+  // Returns a nonzero entry for each package which matches.
+  std::vector<uint8_t> Evaluate(const PackageColumns& columns) const;
+
+  // Removes packages which don't match, preserving the order of the rest.
+  void Apply(std::vector<aur::Package>* packages) const;
+
+ private:
+  struct Node;
+  class Parser;
+
+  static void EvaluateNode(const Node& node, const PackageColumns& columns,
+                           std::vector<uint8_t>* out);
+
+  std::shared_ptr<const Node> root_;
+};
+
+}  // namespace auracle
+
+#endif  // AURACLE_FILTER_HH_
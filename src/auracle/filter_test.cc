@@ -0,0 +1,108 @@
+#include "filter.hh"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+using testing::ElementsAre;
+
+namespace {
+
+constexpr std::chrono::seconds kEpochSeconds(1600000000);
+const auracle::Filter::Clock::time_point kNow(kEpochSeconds);
+
+std::vector<aur::Package> MakePackages() {
+  std::vector<aur::Package> packages;
+
+  {
+    auto& p = packages.emplace_back();
+    p.name = "auracle-git";
+    p.maintainer = "falconindy";
+    p.votes = 60;
+    p.popularity = 1.5;
+    p.modified = kEpochSeconds - 24h;
+  }
+  {
+    auto& p = packages.emplace_back();
+    p.name = "cower";
+    p.maintainer = "";
+    p.votes = 900;
+    p.popularity = 0.01;
+    p.modified = kEpochSeconds - 3 * 365 * 24h;
+    p.out_of_date = kEpochSeconds - 2 * 365 * 24h;
+  }
+  {
+    auto& p = packages.emplace_back();
+    p.name = "pkgfile-git";
+    p.maintainer = "falconindy";
+    p.votes = 10;
+    p.popularity = 0.2;
+    p.modified = kEpochSeconds - 30 * 24h;
+  }
+
+  return packages;
+}
+
+std::vector<std::string> Filtered(std::string_view expr) {
+  std::string error;
+  const auto filter = auracle::Filter::Parse(expr, kNow, &error);
+  EXPECT_TRUE(filter.has_value()) << expr << ": " << error;
+  if (!filter) {
+    return {};
+  }
+
+  auto packages = MakePackages();
+  filter->Apply(&packages);
+
+  std::vector<std::string> names;
+  for (const auto& p : packages) {
+    names.push_back(p.name);
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST(FilterTest, ComparesColumns) {
+  EXPECT_THAT(Filtered("votes > 50"), ElementsAre("auracle-git", "cower"));
+  EXPECT_THAT(Filtered("votes>=60"), ElementsAre("auracle-git", "cower"));
+  EXPECT_THAT(Filtered("votes == 10"), ElementsAre("pkgfile-git"));
+  EXPECT_THAT(Filtered("votes != 10"), ElementsAre("auracle-git", "cower"));
+  EXPECT_THAT(Filtered("popularity < 0.5"),
+              ElementsAre("cower", "pkgfile-git"));
+}
+
+TEST(FilterTest, ComparesTimestampsAgainstDurations) {
+  EXPECT_THAT(Filtered("modified > 1y"),
+              ElementsAre("auracle-git", "pkgfile-git"));
+  EXPECT_THAT(Filtered("modified > 2d"), ElementsAre("auracle-git"));
+  EXPECT_THAT(Filtered("modified <= 4w"), ElementsAre("cower", "pkgfile-git"));
+  EXPECT_THAT(Filtered("modified > 1550000000"),
+              ElementsAre("auracle-git", "pkgfile-git"));
+}
+
+TEST(FilterTest, CombinesTerms) {
+  EXPECT_THAT(Filtered("outofdate"), ElementsAre("cower"));
+  EXPECT_THAT(Filtered("!outofdate"),
+              ElementsAre("auracle-git", "pkgfile-git"));
+  EXPECT_THAT(Filtered("orphan || votes < 20"),
+              ElementsAre("cower", "pkgfile-git"));
+  EXPECT_THAT(Filtered("votes > 50 && !outofdate && modified > 1y"),
+              ElementsAre("auracle-git"));
+  EXPECT_THAT(Filtered("!(votes > 50 || orphan)"), ElementsAre("pkgfile-git"));
+}
+
+TEST(FilterTest, RejectsInvalidExpressions) {
+  for (const auto* expr : {"", "votes", "votes >", "votes > x", "name == 1",
+                           "votes > 1d", "orphan == 1", "(votes > 1",
+                           "votes > 1 &&", "votes > 1 votes",
+                           "votes > 1\xe2\x80\x8b", "\xc3\xa9 > 1"}) {
+    std::string error;
+    EXPECT_FALSE(auracle::Filter::Parse(expr, kNow, &error).has_value())
+        << expr;
+    EXPECT_FALSE(error.empty()) << expr;
+  }
+}
@@ -1,12 +1,19 @@
 #include "format.hh"
 
 #include <fmt/printf.h>
+#include <locale.h>
+#include <time.h>
 
-#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
 #include <iostream>
-#include <sstream>
+#include <memory>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 
+#include "aur/profiler.hh"
 #include "terminal.hh"
 
 namespace {
@@ -39,6 +46,48 @@ struct is_containerlike {
   enum { value = decltype(test<T>(0))::value };
 };
 
+// Formats a timestamp with strftime(3) in the "C" locale, to match the output
+// of std::put_time on a default constructed stream.
+template <typename OutputIt>
+OutputIt FormatTimestamp(OutputIt out, std::chrono::seconds seconds,
+                         std::string_view format) {
+  // Read the timezone and create the locale just once, rather than for every
+  // timestamp.
+  static const locale_t c_locale = [] {
+    tzset();
+    return newlocale(LC_ALL_MASK, "C", locale_t(0));
+  }();
+
+  const auto point = std::chrono::system_clock::to_time_t(
+      std::chrono::system_clock::time_point(seconds));
+  std::tm tm{};
+  localtime_r(&point, &tm);
+
+  // strftime needs a NUL terminated pattern, which a view into the format
+  // string isn't.
+  char pattern[64];
+  std::string long_pattern;
+  const char* p = pattern;
+  if (format.size() < sizeof(pattern)) {
+    std::copy(format.begin(), format.end(), pattern);
+    pattern[format.size()] = '\0';
+  } else {
+    long_pattern.assign(format);
+    p = long_pattern.c_str();
+  }
+
+  char buf[256];
+  const size_t n = strftime_l(buf, sizeof(buf), p, &tm, c_locale);
+  if (n > 0 || format.empty()) {
+    return std::copy(buf, buf + n, out);
+  }
+
+  // Either the result is empty, or it didn't fit.
+  std::string big(4096, '\0');
+  big.resize(strftime_l(big.data(), big.size(), p, &tm, c_locale));
+  return std::copy(big.begin(), big.end(), out);
+}
+
 fmt::format_parse_context::iterator parse_format_or_default(
     fmt::format_parse_context& ctx, std::string_view default_value,
     std::string* out) {
@@ -60,21 +109,20 @@ FMT_BEGIN_NAMESPACE
 template <>
 struct formatter<std::chrono::seconds> {
   auto parse(fmt::format_parse_context& ctx) {
-    return parse_format_or_default(ctx, "%c", &tm_format);
+    auto iter = std::find(ctx.begin(), ctx.end(), '}');
+    if (ctx.begin() != iter) {
+      tm_format = std::string_view(&*ctx.begin(), iter - ctx.begin());
+    }
+
+    return iter;
   }
 
   auto format(const std::chrono::seconds& seconds, fmt::format_context& ctx) {
-    auto point = std::chrono::system_clock::to_time_t(
-        std::chrono::system_clock::time_point(seconds));
-
-    std::tm tm{};
-    std::stringstream ss;
-    ss << std::put_time(localtime_r(&point, &tm), &tm_format[0]);
-
-    return format_to(ctx.out(), "{}", ss.str());
+    return FormatTimestamp(ctx.out(), seconds, tm_format);
   }
 
-  std::string tm_format;
+  // Points into the format string, which outlives the formatter.
+  std::string_view tm_format = "%c";
 };
 
 // Specialization for formatting vectors of things with an optional custom
@@ -136,8 +184,55 @@ FMT_END_NAMESPACE
 
 namespace format {
 
+namespace {
+
+// Output accumulates here until there's enough of it to be worth a write.
+constexpr size_t kFlushThreshold = 64 * 1024;
+
+fmt::memory_buffer& Buffer() {
+  static fmt::memory_buffer buffer;
+  return buffer;
+}
+
+auto Out() { return std::back_inserter(Buffer()); }
+
+void MaybeFlush() {
+  if (Buffer().size() >= kFlushThreshold) {
+    Flush();
+  }
+}
+
+void FormatInstalled(const std::optional<auracle::Pacman::Package>& local,
+                     const aur::Package& package) {
+  namespace t = terminal;
+
+  const auto local_ver_color =
+      auracle::Pacman::Vercmp(local->pkgver, package.version) < 0
+          ? &t::BoldRed
+          : &t::BoldGreen;
+  fmt::format_to(Out(), "[installed: {}]", local_ver_color(local->pkgver));
+}
+
+}  // namespace
+
+void Flush() {
+  auto& buffer = Buffer();
+  if (buffer.size() == 0) {
+    return;
+  }
+
+  aur::Profiler::Scope scope(aur::Profiler::Phase::FORMAT);
+
+  // Hand the whole buffer to the streambuf at once, bypassing the formatting
+  // layers of the ostream.
+  std::cout.rdbuf()->sputn(buffer.data(), buffer.size());
+  std::cout.flush();
+  buffer.clear();
+}
+
 void NameOnly(const aur::Package& package) {
-  std::cout << fmt::format(terminal::Bold("{}\n"), package.name);
+  fmt::format_to(Out(), "{}\n", terminal::Bold(package.name));
+  MaybeFlush();
 }
 
 void Short(const aur::Package& package,
@@ -150,19 +245,15 @@ void Short(const aur::Package& package,
                              ? &t::BoldRed
                              : &t::BoldGreen;
 
-  std::string installed_package;
+  fmt::format_to(Out(), "{}{} {} ({}, {}) ", t::BoldMagenta("aur/"),
+                 t::Bold(p.name), ood_color(p.version), p.votes,
+                 p.popularity);
   if (l) {
-    const auto local_ver_color =
-        auracle::Pacman::Vercmp(l->pkgver, p.version) < 0 ? &t::BoldRed
-                                                          : &t::BoldGreen;
-    installed_package =
-        fmt::format("[installed: {}]", local_ver_color(l->pkgver));
+    FormatInstalled(l, p);
   }
+  fmt::format_to(Out(), "\n    {}\n", p.description);
 
-  std::cout << fmt::format("{}{} {} ({}, {}) {}\n    {}\n",
-                           t::BoldMagenta("aur/"), t::Bold(p.name),
-                           ood_color(p.version), p.votes, p.popularity,
-                           installed_package, p.description);
+  MaybeFlush();
 }
 
 void Long(const aur::Package& package,
@@ -176,115 +267,452 @@ void Long(const aur::Package& package,
                              ? &t::BoldRed
                              : &t::BoldGreen;
 
-  std::string installed_package;
+  const auto out = Out();
+  fmt::format_to(out, "{}", Field("Repository", t::BoldMagenta("aur")));
+  fmt::format_to(out, "{}", Field("Name", p.name));
+
+  fmt::format_to(out, "{:14s} : {}", "Version", ood_color(p.version));
   if (l) {
-    const auto local_ver_color =
-        auracle::Pacman::Vercmp(l->pkgver, p.version) < 0 ? &t::BoldRed
-                                                          : &t::BoldGreen;
-    installed_package =
-        fmt::format(" [installed: {}]", local_ver_color(l->pkgver));
+    fmt::format_to(out, " ");
+    FormatInstalled(l, p);
   }
-
-  std::cout << fmt::format("{}", Field("Repository", t::BoldMagenta("aur")));
-  std::cout << fmt::format("{}", Field("Name", p.name));
-  std::cout << fmt::format(
-      "{}", Field("Version", ood_color(p.version) + installed_package));
+  fmt::format_to(out, "\n");
 
   if (p.name != p.pkgbase) {
-    std::cout << fmt::format("{}", Field("PackageBase", p.pkgbase));
-  }
-
-  std::cout << fmt::format("{}", Field("URL", t::BoldCyan(p.upstream_url)));
-  std::cout << fmt::format(
-      "{}", Field("AUR Page",
-                  t::BoldCyan("https://aur.archlinux.org/packages/" + p.name)));
-  std::cout << fmt::format("{}", Field("Keywords", p.keywords));
-  std::cout << fmt::format("{}", Field("Groups", p.groups));
-  std::cout << fmt::format("{}", Field("Depends On", p.depends));
-  std::cout << fmt::format("{}", Field("Makedepends", p.makedepends));
-  std::cout << fmt::format("{}", Field("Checkdepends", p.checkdepends));
-  std::cout << fmt::format("{}", Field("Provides", p.provides));
-  std::cout << fmt::format("{}", Field("Conflicts With", p.conflicts));
-  std::cout << fmt::format("{}",
-                           Field("Optional Deps", OptDepends{p.optdepends}));
-  std::cout << fmt::format("{}", Field("Replaces", p.replaces));
-  std::cout << fmt::format("{}", Field("Licenses", p.licenses));
-  std::cout << fmt::format("{}", Field("Votes", p.votes));
-  std::cout << fmt::format("{}", Field("Popularity", p.popularity));
-  std::cout << fmt::format(
-      "{}",
+    fmt::format_to(out, "{}", Field("PackageBase", p.pkgbase));
+  }
+
+  fmt::format_to(out, "{}", Field("URL", t::BoldCyan(p.upstream_url)));
+  fmt::format_to(out, "{:14s} : {}https://aur.archlinux.org/packages/{}{}\n",
+                 "AUR Page", t::StartColor(t::Color::BOLD_CYAN), p.name,
+                 t::ResetColor());
+  fmt::format_to(out, "{}", Field("Keywords", p.keywords));
+  fmt::format_to(out, "{}", Field("Groups", p.groups));
+  fmt::format_to(out, "{}", Field("Depends On", p.depends));
+  fmt::format_to(out, "{}", Field("Makedepends", p.makedepends));
+  fmt::format_to(out, "{}", Field("Checkdepends", p.checkdepends));
+  fmt::format_to(out, "{}", Field("Provides", p.provides));
+  fmt::format_to(out, "{}", Field("Conflicts With", p.conflicts));
+  fmt::format_to(out, "{}", Field("Optional Deps", OptDepends{p.optdepends}));
+  fmt::format_to(out, "{}", Field("Replaces", p.replaces));
+  fmt::format_to(out, "{}", Field("Licenses", p.licenses));
+  fmt::format_to(out, "{}", Field("Votes", p.votes));
+  fmt::format_to(out, "{}", Field("Popularity", p.popularity));
+  fmt::format_to(
+      out, "{}",
       Field("Maintainer", p.maintainer.empty() ? "(orphan)" : p.maintainer));
-  std::cout << fmt::format("{}", Field("Submitted", p.submitted));
-  std::cout << fmt::format("{}", Field("Last Modified", p.modified));
+  fmt::format_to(out, "{}", Field("Submitted", p.submitted));
+  fmt::format_to(out, "{}", Field("Last Modified", p.modified));
   if (p.out_of_date != std::chrono::seconds::zero()) {
-    std::cout << fmt::format("{}", Field("Out of Date", p.out_of_date));
+    fmt::format_to(out, "{}", Field("Out of Date", p.out_of_date));
   }
-  std::cout << fmt::format("{}", Field("Description", p.description));
-  std::cout << fmt::format("\n");
+  fmt::format_to(out, "{}", Field("Description", p.description));
+  fmt::format_to(out, "\n");
+
+  MaybeFlush();
 }
 
 void Update(const auracle::Pacman::Package& from, const aur::Package& to) {
   namespace t = terminal;
 
-  std::cout << fmt::format("{} {} -> {}\n", t::Bold(from.pkgname),
-                           t::BoldRed(from.pkgver), t::BoldGreen(to.version));
+  fmt::format_to(Out(), "{} {} -> {}\n", t::Bold(from.pkgname),
+                 t::BoldRed(from.pkgver), t::BoldGreen(to.version));
+  MaybeFlush();
 }
 
 namespace {
 
-void FormatCustomTo(std::string& out, const std::string& format,
-                    const aur::Package& package) {
-  // clang-format off
-  fmt::format_to(
-      std::back_inserter(out), format,
-      fmt::arg("name", package.name),
-      fmt::arg("description", package.description),
-      fmt::arg("maintainer", package.maintainer),
-      fmt::arg("version", package.version),
-      fmt::arg("pkgbase", package.pkgbase),
-      fmt::arg("url", package.upstream_url),
-
-      fmt::arg("votes", package.votes),
-      fmt::arg("popularity", package.popularity),
-
-      fmt::arg("submitted", package.submitted),
-      fmt::arg("modified", package.modified),
-      fmt::arg("outofdate", package.out_of_date),
-
-      fmt::arg("depends", package.depends),
-      fmt::arg("makedepends", package.makedepends),
-      fmt::arg("checkdepends", package.checkdepends),
-
-      fmt::arg("conflicts", package.conflicts),
-      fmt::arg("groups", package.groups),
-      fmt::arg("keywords", package.keywords),
-      fmt::arg("licenses", package.licenses),
-      fmt::arg("optdepends", package.optdepends),
-      fmt::arg("provides", package.provides),
-      fmt::arg("replaces", package.replaces));
-  // clang-format on
+// A minimal JSON writer which appends directly to the output buffer.
+class JsonWriter {
+ public:
+  JsonWriter() { Buffer().push_back('{'); }
+  ~JsonWriter() {
+    auto& buffer = Buffer();
+    buffer.push_back('}');
+    buffer.push_back('\n');
+  }
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  void Member(std::string_view key, std::string_view value) {
+    Key(key);
+    String(value);
+  }
+
+  void Member(std::string_view key, int value) {
+    Key(key);
+    fmt::format_to(Out(), "{}", value);
+  }
+
+  void Member(std::string_view key, int64_t value) {
+    Key(key);
+    fmt::format_to(Out(), "{}", value);
+  }
+
+  void Member(std::string_view key, double value) {
+    Key(key);
+    fmt::format_to(Out(), "{}", value);
+  }
+
+  // The RPC interface represents unset timestamps and maintainers as null, so
+  // we do too.
+  void NullableMember(std::string_view key, std::chrono::seconds value) {
+    Key(key);
+    if (value == std::chrono::seconds::zero()) {
+      Append("null");
+    } else {
+      fmt::format_to(Out(), "{}", value.count());
+    }
+  }
+
+  void NullableMember(std::string_view key, std::string_view value) {
+    Key(key);
+    if (value.empty()) {
+      Append("null");
+    } else {
+      String(value);
+    }
+  }
+
+  template <typename T>
+  void ArrayMember(std::string_view key, const std::vector<T>& values) {
+    if (values.empty()) {
+      return;
+    }
+
+    Key(key);
+    Buffer().push_back('[');
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (i > 0) {
+        Buffer().push_back(',');
+      }
+
+      if constexpr (std::is_same_v<T, aur::Dependency>) {
+        String(values[i].depstring);
+      } else {
+        String(values[i]);
+      }
+    }
+    Buffer().push_back(']');
+  }
+
+ private:
+  static void Append(std::string_view s) {
+    Buffer().append(s.data(), s.data() + s.size());
+  }
+
+  void Key(std::string_view key) {
+    if (!first_) {
+      Buffer().push_back(',');
+    }
+    first_ = false;
+
+    String(key);
+    Buffer().push_back(':');
+  }
+
+  static void String(std::string_view s) {
+    auto& buffer = Buffer();
+    buffer.push_back('"');
+
+    // Copy runs of characters which don't need escaping in one go.
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+      const auto c = static_cast<unsigned char>(s[i]);
+      if (c >= 0x20 && c != '"' && c != '\\') {
+        continue;
+      }
+
+      Append(s.substr(run, i - run));
+      run = i + 1;
+
+      switch (c) {
+        case '"':
+          Append("\\\"");
+          break;
+        case '\\':
+          Append("\\\\");
+          break;
+        case '\n':
+          Append("\\n");
+          break;
+        case '\r':
+          Append("\\r");
+          break;
+        case '\t':
+          Append("\\t");
+          break;
+        default:
+          fmt::format_to(Out(), "\\u{:04x}", c);
+          break;
+      }
+    }
+    Append(s.substr(run));
+
+    buffer.push_back('"');
+  }
+
+  bool first_ = true;
+};
+
+}  // namespace
+
+void Json(const aur::Package& package) {
+  const auto& p = package;
+
+  {
+    // Keys are named as in the RPC interface.
+    JsonWriter json;
+    json.Member("ID", p.package_id);
+    json.Member("Name", p.name);
+    json.Member("PackageBaseID", p.pkgbase_id);
+    json.Member("PackageBase", p.pkgbase);
+    json.Member("Version", p.version);
+    json.Member("Description", p.description);
+    json.Member("URL", p.upstream_url);
+    json.Member("NumVotes", p.votes);
+    json.Member("Popularity", p.popularity);
+    json.NullableMember("OutOfDate", p.out_of_date);
+    json.NullableMember("Maintainer", p.maintainer);
+    json.Member("FirstSubmitted", int64_t{p.submitted.count()});
+    json.Member("LastModified", int64_t{p.modified.count()});
+    json.Member("URLPath", p.aur_urlpath);
+    json.ArrayMember("Depends", p.depends);
+    json.ArrayMember("MakeDepends", p.makedepends);
+    json.ArrayMember("CheckDepends", p.checkdepends);
+    json.ArrayMember("OptDepends", p.optdepends);
+    json.ArrayMember("Conflicts", p.conflicts);
+    json.ArrayMember("Provides", p.provides);
+    json.ArrayMember("Replaces", p.replaces);
+    json.ArrayMember("Groups", p.groups);
+    json.ArrayMember("Keywords", p.keywords);
+    json.ArrayMember("License", p.licenses);
+  }
+
+  MaybeFlush();
+}
+
+class FieldFormatter {
+ public:
+  virtual ~FieldFormatter() = default;
+
+  virtual void Format(const aur::Package& package,
+                      fmt::format_context& ctx) const = 0;
+};
+
+namespace {
+
+// Parses its spec once, up front, into the formatter for the field's type, and
+// keeps that formatter to apply to every package.
+template <auto kMember>
+class TypedFieldFormatter : public FieldFormatter {
+ public:
+  using T = std::remove_cv_t<std::remove_reference_t<decltype(
+      std::declval<const aur::Package&>().*kMember)>>;
+
+  // Not every version of fmt has a formatter for std::string itself.
+  using Formatted = std::conditional_t<std::is_same_v<T, std::string>,
+                                       fmt::string_view, T>;
+
+  explicit TypedFieldFormatter(std::string_view spec) : spec_(spec) {
+    // Dynamic widths and precisions would have to be looked up among the
+    // arguments at format time, and a field's formatter has none.
+    if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) {
+      if (spec_.find('{') != std::string::npos) {
+        throw fmt::format_error("nested replacement fields are not supported");
+      }
+    }
+
+    fmt::format_parse_context ctx(spec_);
+    if (formatter_.parse(ctx) != ctx.end()) {
+      throw fmt::format_error("invalid format specifier");
+    }
+  }
+
+  void Format(const aur::Package& package,
+              fmt::format_context& ctx) const override {
+    const auto& value = package.*kMember;
+
+    if constexpr (std::is_same_v<T, std::string>) {
+      if (spec_.empty()) {
+        ctx.advance_to(std::copy(value.begin(), value.end(), ctx.out()));
+        return;
+      }
+    }
+
+    ctx.advance_to(formatter_.format(Formatted(value), ctx));
+  }
+
+ private:
+  // Formatters may keep views into their spec, so it's declared first, to
+  // outlive the formatter.
+  const std::string spec_;
+
+  // Not every formatter's format() is const, though none of them change.
+  mutable fmt::formatter<Formatted> formatter_;
+};
+
+template <auto kMember>
+std::shared_ptr<const FieldFormatter> MakeField(std::string_view spec) {
+  return std::make_shared<TypedFieldFormatter<kMember>>(spec);
+}
+
+bool IsDigits(std::string_view s) {
+  return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) {
+    return c >= '0' && c <= '9';
+  });
 }
 
 }  // namespace
 
-void Custom(const std::string& format, const aur::Package& package) {
-  std::string out;
+// static
+std::optional<Template> Template::Compile(std::string_view format,
+                                          std::string* error) {
+  using Factory = std::shared_ptr<const FieldFormatter> (*)(std::string_view);
+
+  // Fields may also be referred to by position, as they could when the format
+  // was handed straight to fmt, so their order here mustn't change.
+  static constexpr std::pair<std::string_view, Factory> kFields[] = {
+      {"name", &MakeField<&aur::Package::name>},
+      {"description", &MakeField<&aur::Package::description>},
+      {"maintainer", &MakeField<&aur::Package::maintainer>},
+      {"version", &MakeField<&aur::Package::version>},
+      {"pkgbase", &MakeField<&aur::Package::pkgbase>},
+      {"url", &MakeField<&aur::Package::upstream_url>},
+      {"votes", &MakeField<&aur::Package::votes>},
+      {"popularity", &MakeField<&aur::Package::popularity>},
+      {"submitted", &MakeField<&aur::Package::submitted>},
+      {"modified", &MakeField<&aur::Package::modified>},
+      {"outofdate", &MakeField<&aur::Package::out_of_date>},
+      {"depends", &MakeField<&aur::Package::depends>},
+      {"makedepends", &MakeField<&aur::Package::makedepends>},
+      {"checkdepends", &MakeField<&aur::Package::checkdepends>},
+      {"conflicts", &MakeField<&aur::Package::conflicts>},
+      {"groups", &MakeField<&aur::Package::groups>},
+      {"keywords", &MakeField<&aur::Package::keywords>},
+      {"licenses", &MakeField<&aur::Package::licenses>},
+      {"optdepends", &MakeField<&aur::Package::optdepends>},
+      {"provides", &MakeField<&aur::Package::provides>},
+      {"replaces", &MakeField<&aur::Package::replaces>},
+  };
+
+  Template t;
+  std::string literal;
+
+  // As in fmt, fields are numbered either automatically or manually, never
+  // both.
+  int next_index = 0;
+  bool manual_indexing = false;
+
+  const auto flush_literal = [&t, &literal] {
+    if (!literal.empty()) {
+      t.pieces_.push_back({std::move(literal), nullptr});
+      literal.clear();
+    }
+  };
+
+  for (size_t i = 0; i < format.size(); ++i) {
+    const char c = format[i];
+
+    if (c == '}') {
+      if (i + 1 < format.size() && format[i + 1] == '}') {
+        literal.push_back('}');
+        ++i;
+        continue;
+      }
+
+      error->assign("unmatched '}' in format string");
+      return std::nullopt;
+    }
+
+    if (c != '{') {
+      literal.push_back(c);
+      continue;
+    }
 
-  FormatCustomTo(out, format, package);
+    if (i + 1 < format.size() && format[i + 1] == '{') {
+      literal.push_back('{');
+      ++i;
+      continue;
+    }
+
+    const auto close = format.find('}', i + 1);
+    if (close == std::string_view::npos) {
+      error->assign("missing '}' in format string");
+      return std::nullopt;
+    }
 
-  std::cout << out << "\n";
+    const auto replacement = format.substr(i + 1, close - i - 1);
+    const auto colon = replacement.find(':');
+    const auto id = replacement.substr(0, colon);
+    const auto spec = colon == std::string_view::npos
+                          ? std::string_view()
+                          : replacement.substr(colon + 1);
+
+    size_t index = std::size(kFields);
+    if (id.empty()) {
+      if (manual_indexing) {
+        error->assign(
+            "cannot switch from manual to automatic argument indexing");
+        return std::nullopt;
+      }
+      index = next_index++;
+    } else if (IsDigits(id)) {
+      if (next_index > 0) {
+        error->assign(
+            "cannot switch from automatic to manual argument indexing");
+        return std::nullopt;
+      }
+      manual_indexing = true;
+      if (id.size() < 3) {
+        index = std::stoul(std::string(id));
+      }
+    } else {
+      index = std::find_if(std::begin(kFields), std::end(kFields),
+                           [id](const auto& entry) {
+                             return entry.first == id;
+                           }) -
+              std::begin(kFields);
+    }
+
+    if (index >= std::size(kFields)) {
+      error->assign("argument not found");
+      return std::nullopt;
+    }
+
+    flush_literal();
+    try {
+      t.pieces_.push_back({std::string(), kFields[index].second(spec)});
+    } catch (const fmt::format_error& e) {
+      error->assign(e.what());
+      return std::nullopt;
+    }
+    i = close;
+  }
+
+  flush_literal();
+
+  return t;
 }
 
-bool FormatIsValid(const std::string& format, std::string* error) {
-  try {
-    std::string out;
-    FormatCustomTo(out, format, aur::Package());
-  } catch (const fmt::format_error& e) {
-    error->assign(e.what());
-    return false;
+void Custom(const Template& format, const aur::Package& package) {
+  auto& buffer = Buffer();
+
+  // The context writes to the same buffer that literals are appended to.
+  const fmt::format_context::iterator out(buffer);
+  fmt::format_context ctx(out, fmt::format_args());
+  for (const auto& piece : format.pieces_) {
+    if (piece.field == nullptr) {
+      buffer.append(piece.literal.data(),
+                    piece.literal.data() + piece.literal.size());
+    } else {
+      piece.field->Format(package, ctx);
+    }
   }
+  buffer.push_back('\n');
 
-  return true;
+  MaybeFlush();
 }
 
 }  // namespace format
@@ -1,22 +1,61 @@
 #ifndef AURACLE_FORMAT_HH_
 #define AURACLE_FORMAT_HH_
 
+#include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "aur/package.hh"
 #include "pacman.hh"
 
 namespace format {
 
+// Formats one field of a package according to a spec which was parsed ahead
+// of time. Defined in format.cc.
+class FieldFormatter;
+
+// A custom --format string, compiled once into a sequence of literal text and
+// package fields so that rendering doesn't need to parse it again.
+class Template {
+ public:
+  Template() = default;
+
+  // Returns std::nullopt and fills |error| if the format isn't valid.
+  static std::optional<Template> Compile(std::string_view format,
+                                         std::string* error);
+
+  bool empty() const { return pieces_.empty(); }
+
+ private:
+  friend void Custom(const Template& format, const aur::Package& package);
+
+  struct Piece {
+    // Printed as is, when there's no field.
+    std::string literal;
+    std::shared_ptr<const FieldFormatter> field;
+  };
+
+  std::vector<Piece> pieces_;
+};
+
 void NameOnly(const aur::Package& package);
 void Update(const auracle::Pacman::Package& from, const aur::Package& to);
 void Short(const aur::Package& package,
            const std::optional<auracle::Pacman::Package>& local_package);
 void Long(const aur::Package& package,
           const std::optional<auracle::Pacman::Package>& local_package);
-void Custom(const std::string& format, const aur::Package& package);
+void Custom(const Template& format, const aur::Package& package);
+
+// Writes the package as a single line JSON object, using the same keys as the
+// RPC interface.
+void Json(const aur::Package& package);
 
-bool FormatIsValid(const std::string& format, std::string* error);
+// Output is accumulated in memory and written to stdout in large chunks.
+// Callers must flush once they're done printing a batch of results, or before
+// writing to stdout by other means.
+void Flush();
 
 }  // namespace format
 
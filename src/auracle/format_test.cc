@@ -5,6 +5,7 @@
 
 #include "aur/package.hh"
 #include "gtest/gtest.h"
+#include "terminal.hh"
 
 class ScopedCapturer {
  public:
@@ -15,6 +16,8 @@ class ScopedCapturer {
   ~ScopedCapturer() { stream_.rdbuf(original_sbuf_); }
 
   std::string GetCapturedOutput() {
+    format::Flush();
+
     auto str = buffer_.str();
     buffer_.str(std::string());
     return str;
@@ -51,16 +54,49 @@ aur::Package MakePackage() {
   return p;
 }
 
+void Custom(std::string_view format, const aur::Package& package) {
+  std::string error;
+  const auto compiled = format::Template::Compile(format, &error);
+  ASSERT_TRUE(compiled.has_value()) << error;
+
+  format::Custom(*compiled, package);
+}
+
 TEST(FormatTest, DetectsInvalidFormats) {
-  std::string err;
-  EXPECT_FALSE(format::FormatIsValid("{invalid}", &err));
-  EXPECT_FALSE(err.empty());
+  for (const auto* f :
+       {"{invalid}", "{name", "name}", "{votes:%Y}", "{name:>{votes}}",
+        "{name:q}", "{21}", "{}{1}", "{0}{}"}) {
+    std::string err;
+    EXPECT_FALSE(format::Template::Compile(f, &err).has_value()) << f;
+    EXPECT_FALSE(err.empty()) << f;
+  }
+}
+
+TEST(FormatTest, CustomLiteralFormat) {
+  ScopedCapturer capture(std::cout);
+
+  Custom("{{{name}}} {{}}", MakePackage());
+  EXPECT_EQ(capture.GetCapturedOutput(), "{cower} {}\n");
+
+  Custom("{name:>8}|{votes:03}", MakePackage());
+  EXPECT_EQ(capture.GetCapturedOutput(), "   cower|000\n");
+}
+
+TEST(FormatTest, CustomPositionalFormat) {
+  ScopedCapturer capture(std::cout);
+
+  // Fields are numbered in the order they're documented in.
+  Custom("{}:{}", MakePackage());
+  EXPECT_EQ(capture.GetCapturedOutput(), "cower:\n");
+
+  Custom("{3} {0:>6} {name}", MakePackage());
+  EXPECT_EQ(capture.GetCapturedOutput(), "1.2.3  cower cower\n");
 }
 
 TEST(FormatTest, CustomStringFormat) {
   ScopedCapturer capture(std::cout);
 
-  format::Custom("{name} -> {version}", MakePackage());
+  Custom("{name} -> {version}", MakePackage());
 
   EXPECT_EQ(capture.GetCapturedOutput(), "cower -> 1.2.3\n");
 }
@@ -70,10 +106,10 @@ TEST(FormatTest, CustomFloatFormat) {
 
   auto p = MakePackage();
 
-  format::Custom("{popularity}", p);
+  Custom("{popularity}", p);
   EXPECT_EQ(capture.GetCapturedOutput(), "5.20238\n");
 
-  format::Custom("{popularity:.2f}", p);
+  Custom("{popularity:.2f}", p);
   EXPECT_EQ(capture.GetCapturedOutput(), "5.20\n");
 }
 
@@ -82,11 +118,16 @@ TEST(FormatTest, CustomDateTimeFormat) {
 
   auto p = MakePackage();
 
-  format::Custom("{submitted}", p);
+  Custom("{submitted}", p);
   EXPECT_EQ(capture.GetCapturedOutput(), "Sun Jul  2 16:40:08 2017\n");
 
-  format::Custom("{submitted:%s}", p);
+  Custom("{submitted:%s}", p);
   EXPECT_EQ(capture.GetCapturedOutput(), "1499013608\n");
+
+  // Longer than any fixed size scratch space.
+  const std::string pattern(100, 'x');
+  Custom("{submitted:" + pattern + "%Y}", p);
+  EXPECT_EQ(capture.GetCapturedOutput(), pattern + "2017\n");
 }
 
 TEST(FormatTest, ListFormat) {
@@ -94,9 +135,41 @@ TEST(FormatTest, ListFormat) {
 
   auto p = MakePackage();
 
-  format::Custom("{conflicts}", p);
+  Custom("{conflicts}", p);
   EXPECT_EQ(capture.GetCapturedOutput(), "auracle  cower  cower-git\n");
 
-  format::Custom("{conflicts::,,}", p);
+  Custom("{conflicts::,,}", p);
   EXPECT_EQ(capture.GetCapturedOutput(), "auracle:,,cower:,,cower-git\n");
 }
+
+TEST(FormatTest, ColorsOutput) {
+  ScopedCapturer capture(std::cout);
+
+  terminal::Init(terminal::WantColor::YES);
+  format::NameOnly(MakePackage());
+  EXPECT_EQ(capture.GetCapturedOutput(), "\033[1mcower\033[0m\n");
+
+  terminal::Init(terminal::WantColor::NO);
+  format::NameOnly(MakePackage());
+  EXPECT_EQ(capture.GetCapturedOutput(), "cower\n");
+}
+
+TEST(FormatTest, JsonFormat) {
+  ScopedCapturer capture(std::cout);
+
+  auto p = MakePackage();
+  p.package_id = 1;
+  p.description = "quotes \" and \\ and\ttabs\x01";
+  p.depends.push_back({"cower>=1", "cower", "1", aur::Dependency::Mod::GE});
+
+  format::Json(p);
+  EXPECT_EQ(capture.GetCapturedOutput(),
+            R"({"ID":1,"Name":"cower","PackageBaseID":0,"PackageBase":"",)"
+            R"("Version":"1.2.3",)"
+            R"("Description":"quotes \" and \\ and\ttabs\u0001",)"
+            R"("URL":"","NumVotes":0,"Popularity":5.20238,"OutOfDate":null,)"
+            R"("Maintainer":null,"FirstSubmitted":1499013608,)"
+            R"("LastModified":0,"URLPath":"","Depends":["cower>=1"],)"
+            R"("Conflicts":["auracle","cower","cower-git"]})"
+            "\n");
+}
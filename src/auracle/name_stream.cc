@@ -0,0 +1,66 @@
+#include "name_stream.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <unordered_set>
+
+namespace auracle {
+
+NameStream::NameStream(std::vector<std::string> names) {
+  std::unordered_set<std::string_view> seen;
+  seen.reserve(names.size());
+
+  // Reserving up front keeps the views in |seen| valid.
+  names_.reserve(names.size());
+  for (auto& name : names) {
+    if (seen.count(name) == 0) {
+      seen.insert(names_.emplace_back(std::move(name)));
+    }
+  }
+}
+
+// static
+NameStream NameStream::FromArgs(const std::vector<std::string>& args) {
+  if (args.size() == 1 && args[0] == "-") {
+    return NameStream(&std::cin);
+  }
+
+  return NameStream(args);
+}
+
+bool NameStream::NextBatch(size_t max_names, std::vector<std::string>* batch) {
+  batch->clear();
+
+  if (in_ == nullptr) {
+    const auto count = std::min(max_names, names_.size() - next_);
+    batch->assign(std::make_move_iterator(names_.begin() + next_),
+                  std::make_move_iterator(names_.begin() + next_ + count));
+    next_ += count;
+    return !batch->empty();
+  }
+
+  std::string name;
+  while (batch->size() < max_names && *in_ >> name) {
+    if (seen_.insert(name).second) {
+      batch->push_back(std::move(name));
+    }
+  }
+
+  return !batch->empty();
+}
+
+std::vector<std::string> NameStream::ReadAll() {
+  std::vector<std::string> names;
+
+  std::vector<std::string> batch;
+  while (NextBatch(4096, &batch)) {
+    names.insert(names.end(), std::make_move_iterator(batch.begin()),
+                 std::make_move_iterator(batch.end()));
+  }
+
+  return names;
+}
+
+}  // namespace auracle
@@ -0,0 +1,54 @@
+#ifndef AURACLE_NAME_STREAM_HH_
+#define AURACLE_NAME_STREAM_HH_
+
+#include <istream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace auracle {
+
+// A source of package names, either given up front or read incrementally from
+// a stream. Reading a stream a batch at a time means that arbitrarily long
+// lists of names can be handled without ever holding more than one copy of
+// each distinct name, however often it's repeated. Memory is still O(distinct
+// names), since every name read is remembered in order to drop its repeats.
+class NameStream {
+ public:
+  // Repeated names are dropped.
+  explicit NameStream(std::vector<std::string> names);
+
+  // Names are separated by whitespace. The stream must outlive this object.
+  explicit NameStream(std::istream* in) : in_(in) {}
+
+  // Returns a stream over |args|, or over stdin if |args| is just "-".
+  static NameStream FromArgs(const std::vector<std::string>& args);
+
+  NameStream(const NameStream&) = delete;
+  NameStream& operator=(const NameStream&) = delete;
+
+  NameStream(NameStream&&) = default;
+  NameStream& operator=(NameStream&&) = default;
+
+  // Replaces the contents of |batch| with up to |max_names| of the names not
+  // yet consumed. Names seen in any earlier batch are dropped. Returns false,
+  // leaving |batch| empty, once there are no names left.
+  bool NextBatch(size_t max_names, std::vector<std::string>* batch);
+
+  // Consumes all the remaining names, dropping any repeats.
+  std::vector<std::string> ReadAll();
+
+ private:
+  std::istream* in_ = nullptr;
+
+  std::vector<std::string> names_;
+  size_t next_ = 0;
+
+  // Every name read from |in_| so far. Never pruned, as a repeat may come at
+  // any distance from the first occurrence.
+  std::unordered_set<std::string> seen_;
+};
+
+}  // namespace auracle
+
+#endif  // AURACLE_NAME_STREAM_HH_
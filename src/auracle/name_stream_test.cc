@@ -0,0 +1,60 @@
+#include "name_stream.hh"
+
+#include <sstream>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using auracle::NameStream;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(NameStreamTest, BatchesGivenNames) {
+  NameStream names({"auracle-git", "pkgfile-git", "auracle-git", "cower",
+                    "expac", "pkgfile-git"});
+
+  std::vector<std::string> batch;
+  ASSERT_TRUE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, ElementsAre("auracle-git", "pkgfile-git"));
+  ASSERT_TRUE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, ElementsAre("cower", "expac"));
+  EXPECT_FALSE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, IsEmpty());
+}
+
+TEST(NameStreamTest, ReadsNamesIncrementally) {
+  std::istringstream in("auracle-git pkgfile-git\n\n  auracle-git\tcower\n");
+  NameStream names(&in);
+
+  std::vector<std::string> batch;
+  ASSERT_TRUE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, ElementsAre("auracle-git", "pkgfile-git"));
+
+  // Nothing past the first batch has been consumed yet.
+  EXPECT_EQ(in.tellg(), 23);
+
+  ASSERT_TRUE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, ElementsAre("cower"));
+  EXPECT_FALSE(names.NextBatch(2, &batch));
+}
+
+TEST(NameStreamTest, DropsRepeatsAcrossBatches) {
+  std::istringstream in("cower cower expac cower auracle-git expac cower");
+  NameStream names(&in);
+
+  std::vector<std::string> batch;
+  ASSERT_TRUE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, ElementsAre("cower", "expac"));
+  ASSERT_TRUE(names.NextBatch(2, &batch));
+  EXPECT_THAT(batch, ElementsAre("auracle-git"));
+  EXPECT_FALSE(names.NextBatch(2, &batch));
+}
+
+TEST(NameStreamTest, ReadsEverything) {
+  std::istringstream in("cower expac\ncower auracle-git\n");
+  EXPECT_THAT(NameStream(&in).ReadAll(),
+              ElementsAre("cower", "expac", "auracle-git"));
+
+  std::istringstream empty("\n");
+  EXPECT_THAT(NameStream(&empty).ReadAll(), IsEmpty());
+}
@@ -6,9 +6,10 @@ namespace auracle {
 
 std::pair<const aur::Package*, bool> PackageCache::AddPackage(
     aur::Package package) {
-  const auto iter = std::find(packages_.begin(), packages_.end(), package);
-  if (iter != packages_.cend()) {
-    return {&*iter, false};
+  const auto [iter, added] =
+      index_by_id_.emplace(IdKey(package), packages_.size());
+  if (!added) {
+    return {&packages_[iter->second], false};
   }
 
   const auto& p = packages_.emplace_back(std::move(package));
@@ -1,6 +1,7 @@
 #ifndef PACKAGE_AURACLE_CACHE_HH_
 #define PACKAGE_AURACLE_CACHE_HH_
 
+#include <cstdint>
 #include <functional>
 #include <unordered_map>
 #include <utility>
@@ -34,6 +35,12 @@ class PackageCache {
   void WalkDependencies(const std::string& name, WalkDependenciesFn cb) const;
 
  private:
+  // Packages are equal when both their package and pkgbase IDs match.
+  static int64_t IdKey(const aur::Package& p) {
+    return (static_cast<int64_t>(p.package_id) << 32) |
+           static_cast<uint32_t>(p.pkgbase_id);
+  }
+
   std::vector<aur::Package> packages_;
 
   // We store integer indicies into the packages_ vector above rather than
@@ -41,6 +48,7 @@ class PackageCache {
   // invalidate our index maps.
   std::unordered_map<std::string, int> index_by_pkgname_;
   std::unordered_map<std::string, int> index_by_pkgbase_;
+  std::unordered_map<int64_t, int> index_by_id_;
 };
 
 }  // namespace auracle
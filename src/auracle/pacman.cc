@@ -4,12 +4,18 @@
 #include <glob.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
+#include <iostream>
 #include <iterator>
-#include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "version.hh"
+
 namespace std {
 
 template <>
@@ -24,84 +30,144 @@ struct default_delete<glob_t> {
 
 namespace {
 
-bool notspace(char c) { return !std::isspace(c); }
+constexpr std::string_view kWhitespace = " \t\r\n\f\v";
 
-std::string* ltrim(std::string* s) {
-  s->erase(s->begin(), std::find_if(s->begin(), s->end(), &notspace));
-  return s;
-}
+std::string_view Trim(std::string_view sv) {
+  const auto begin = sv.find_first_not_of(kWhitespace);
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
 
-std::string* rtrim(std::string* s) {
-  s->erase(std::find_if(s->rbegin(), s->rend(), &notspace).base(), s->end());
-  return s;
+  return sv.substr(begin, sv.find_last_not_of(kWhitespace) - begin + 1);
 }
 
-std::string* trim(std::string* s) { return ltrim(rtrim(s)); }
+void SplitWords(std::string_view s, std::vector<std::string>* out) {
+  for (;;) {
+    const auto begin = s.find_first_not_of(kWhitespace);
+    if (begin == std::string_view::npos) {
+      return;
+    }
+    s.remove_prefix(begin);
 
-bool IsSection(const std::string& s) {
-  return s.size() > 2 && s[0] == '[' && s[s.size() - 1] == ']';
+    const auto end = s.find_first_of(kWhitespace);
+    out->emplace_back(s.substr(0, end));
+    if (end == std::string_view::npos) {
+      return;
+    }
+    s.remove_prefix(end);
+  }
 }
 
-}  // namespace
-
-namespace auracle {
-
-Pacman::Pacman(alpm_handle_t* alpm)
-    : alpm_(alpm), local_db_(alpm_get_localdb(alpm_)) {}
+// A single meaningful line of a config file: either a section header, or a
+// key with an optional value. Views point into the owning ConfigFile.
+struct Directive {
+  bool is_section;
+  std::string_view key;
+  std::string_view value;
+};
 
-Pacman::~Pacman() { alpm_release(alpm_); }
+struct ConfigFile {
+  std::string contents;
+  std::vector<Directive> directives;
+};
 
-struct ParseState {
-  alpm_handle_t* alpm;
-  std::string dbpath = "/var/lib/pacman";
-  std::string rootdir = "/";
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream file(path, std::ifstream::binary | std::ifstream::ate);
+  if (!file) {
+    return false;
+  }
 
-  std::string section;
-  std::vector<std::string> repos;
-};
+  contents->resize(file.tellg());
+  file.seekg(0);
+  return bool(file.read(contents->data(), contents->size()));
+}
 
-bool ParseOneFile(const std::string& path, ParseState* state) {
-  std::ifstream file(path);
+void ScanDirectives(ConfigFile* file) {
+  std::string_view sv(file->contents);
 
-  std::string line;
-  while (std::getline(file, line)) {
-    trim(&line);
+  while (!sv.empty()) {
+    auto eol = sv.find('\n');
+    auto line = Trim(sv.substr(0, eol));
+    sv.remove_prefix(eol == std::string_view::npos ? sv.size() : eol + 1);
 
     if (line.empty() || line[0] == '#') {
       continue;
     }
 
-    if (IsSection(line)) {
-      state->section = line.substr(1, line.size() - 2);
+    if (line.size() > 2 && line.front() == '[' && line.back() == ']') {
+      file->directives.push_back({true, line.substr(1, line.size() - 2), {}});
       continue;
     }
 
     auto equals = line.find('=');
-    if (equals == std::string::npos) {
+    if (equals == std::string_view::npos) {
       // There aren't any directives we care about which are valueless.
       continue;
     }
 
-    auto key = line.substr(0, equals);
-    trim(&key);
+    file->directives.push_back({false, Trim(line.substr(0, equals)),
+                                Trim(line.substr(equals + 1))});
+  }
+}
+
+}  // namespace
+
+namespace auracle {
+
+Pacman::Pacman(Config config, std::string cache_dir)
+    : config_(std::move(config)), cache_dir_(std::move(cache_dir)) {}
+
+Pacman::~Pacman() {
+  WaitForBackgroundLoad();
+
+  if (alpm_ != nullptr) {
+    alpm_release(alpm_);
+  }
+}
+
+struct ParseState {
+  Pacman::Config config;
+
+  std::string section;
+  std::unordered_set<std::string> seen_repos;
+
+  // Files which have already been read and scanned, keyed on path. The same
+  // mirrorlist is commonly included once per repo.
+  std::unordered_map<std::string, ConfigFile> files;
+};
+
+bool ParseOneFile(const std::string& path, ParseState* state) {
+  auto [iter, inserted] = state->files.try_emplace(path);
+  auto& file = iter->second;
+  if (inserted && ReadFile(path, &file.contents)) {
+    ScanDirectives(&file);
+  }
 
-    auto value = line.substr(equals + 1);
-    trim(&value);
+  for (const auto& [is_section, key, value] : file.directives) {
+    if (is_section) {
+      state->section = key;
+      continue;
+    }
 
     if (state->section == "options") {
       if (key == "DBPath") {
-        state->dbpath = value;
+        state->config.dbpath = value;
       } else if (key == "RootDir") {
-        state->rootdir = value;
+        state->config.rootdir = value;
+      } else if (key == "IgnorePkg") {
+        SplitWords(value, &state->config.ignorepkgs);
+      } else if (key == "IgnoreGroup") {
+        SplitWords(value, &state->config.ignoregroups);
       }
-    } else {
-      state->repos.emplace_back(state->section);
+    } else if (state->seen_repos.insert(state->section).second) {
+      state->config.repos.emplace_back(state->section);
     }
 
     if (key == "Include") {
       auto globbuf = std::make_unique<glob_t>();
 
-      if (glob(value.c_str(), GLOB_NOCHECK, nullptr, globbuf.get()) != 0) {
+      if (glob(std::string(value).c_str(), GLOB_NOCHECK, nullptr,
+               globbuf.get()) != 0) {
         return false;
       }
 
@@ -113,40 +179,196 @@ bool ParseOneFile(const std::string& path, ParseState* state) {
     }
   }
 
-  file.close();
-
   return true;
 }
 
 // static
-std::unique_ptr<Pacman> Pacman::NewFromConfig(const std::string& config_file) {
+std::unique_ptr<Pacman> Pacman::NewFromConfig(const std::string& config_file,
+                                              const std::string& cache_dir) {
   ParseState state;
 
   if (!ParseOneFile(config_file, &state)) {
     return nullptr;
   }
 
+  return std::unique_ptr<Pacman>(
+      new Pacman(std::move(state.config), cache_dir));
+}
+
+void Pacman::LoadInBackground(DbScope scope) {
+  WaitForBackgroundLoad();
+
+  // The new thread inherits our signal mask, which is important: sd-event
+  // requires SIGCHLD to be blocked in every thread to reap clones.
+  background_load_ =
+      std::async(std::launch::async, [this, scope] { LoadIndex(scope); });
+}
+
+void Pacman::WaitForBackgroundLoad() const {
+  if (background_load_.valid()) {
+    background_load_.get();
+  }
+}
+
+const PacmanIndex* Pacman::index(DbScope scope) const {
+  WaitForBackgroundLoad();
+  return LoadIndex(scope);
+}
+
+alpm_handle_t* Pacman::alpm() const {
+  WaitForBackgroundLoad();
+  return InitializeAlpm();
+}
+
+alpm_db_t* Pacman::local_db() const { return alpm_get_localdb(alpm()); }
+
+const PacmanIndex* Pacman::LoadIndex(DbScope scope) const {
+  // An index of all DBs that's already loaded answers local queries too.
+  if (scope == DbScope::LOCAL && index_ != nullptr) {
+    scope = DbScope::ALL;
+  }
+  const bool local_only = scope == DbScope::LOCAL;
+
+  auto& index = local_only ? local_index_ : index_;
+  auto& loaded = local_only ? local_index_loaded_ : index_loaded_;
+  if (loaded) {
+    return index.get();
+  }
+  loaded = true;
+
+  // libalpm keeps the local DB as a directory with an entry per package, so
+  // its mtime changes whenever a package is installed, upgraded or removed.
+  std::vector<PacmanIndex::DbStamp> stamps;
+  stamps.push_back(
+      PacmanIndex::DbStamp::ForPath("local", config_.dbpath + "/local"));
+  if (!local_only) {
+    for (const auto& repo : config_.repos) {
+      stamps.push_back(PacmanIndex::DbStamp::ForPath(
+          repo, config_.dbpath + "/sync/" + repo + ".db"));
+    }
+  }
+
+  const auto path = IndexPath(scope);
+  if (!path.empty()) {
+    index = PacmanIndex::Open(path, stamps);
+  }
+
+  if (index == nullptr) {
+    index = BuildIndex(scope, std::move(stamps));
+  }
+
+  return index.get();
+}
+
+std::string Pacman::IndexPath(DbScope scope) const {
+  if (cache_dir_.empty()) {
+    return std::string();
+  }
+
+  return cache_dir_ +
+         (scope == DbScope::LOCAL ? "/pacman-local.idx" : "/pacman.idx");
+}
+
+std::unique_ptr<PacmanIndex> Pacman::BuildIndex(
+    DbScope scope, std::vector<PacmanIndex::DbStamp> stamps) const {
+  auto* handle = InitializeAlpm();
+  if (handle == nullptr) {
+    return nullptr;
+  }
+
+  PacmanIndex::Builder builder(std::move(stamps));
+
+  const auto add_db = [&builder](size_t index, alpm_db_t* db) {
+    std::vector<std::string> provides;
+    for (auto i = alpm_db_get_pkgcache(db); i != nullptr; i = i->next) {
+      const auto pkg = static_cast<alpm_pkg_t*>(i->data);
+
+      provides.clear();
+      for (auto p = alpm_pkg_get_provides(pkg); p != nullptr; p = p->next) {
+        auto* depstring =
+            alpm_dep_compute_string(static_cast<alpm_depend_t*>(p->data));
+        provides.emplace_back(depstring);
+        free(depstring);
+      }
+
+      builder.AddPackage(index, alpm_pkg_get_name(pkg),
+                         alpm_pkg_get_version(pkg), provides);
+    }
+  };
+
+  add_db(0, alpm_get_localdb(handle));
+
+  // The index numbers sync DBs in config order. Match them up by name, since
+  // a repo which libalpm refused to register is simply missing from its list.
+  const auto* sync_dbs =
+      scope == DbScope::ALL ? RegisterSyncDbs() : nullptr;
+  for (auto i = sync_dbs; i != nullptr; i = i->next) {
+    const auto db = static_cast<alpm_db_t*>(i->data);
+    const auto repo =
+        std::find(config_.repos.begin(), config_.repos.end(),
+                  alpm_db_get_name(db));
+    if (repo != config_.repos.end()) {
+      add_db(1 + std::distance(config_.repos.begin(), repo), db);
+    }
+  }
+
+  auto bytes = builder.Serialize();
+  if (const auto path = IndexPath(scope); !path.empty()) {
+    // Failing to persist the index only costs us a rebuild next time.
+    PacmanIndex::Write(path, bytes);
+  }
+
+  return PacmanIndex::FromBytes(std::move(bytes));
+}
+
+alpm_handle_t* Pacman::InitializeAlpm() const {
+  if (alpm_ != nullptr || alpm_failed_) {
+    return alpm_;
+  }
+
   alpm_errno_t err;
-  state.alpm = alpm_initialize("/", state.dbpath.c_str(), &err);
-  if (state.alpm == nullptr) {
+  alpm_ = alpm_initialize("/", config_.dbpath.c_str(), &err);
+  if (alpm_ == nullptr) {
+    std::cerr << "error: failed to initialize alpm: " << alpm_strerror(err)
+              << "\n";
+    alpm_failed_ = true;
     return nullptr;
   }
 
-  for (const auto& repo : state.repos) {
-    alpm_register_syncdb(state.alpm, repo.c_str(),
-                         static_cast<alpm_siglevel_t>(0));
+  for (const auto& pkg : config_.ignorepkgs) {
+    alpm_option_add_ignorepkg(alpm_, pkg.c_str());
+  }
+
+  for (const auto& group : config_.ignoregroups) {
+    alpm_option_add_ignoregroup(alpm_, group.c_str());
   }
 
-  return std::unique_ptr<Pacman>(new Pacman(state.alpm));
+  return alpm_;
+}
+
+alpm_list_t* Pacman::RegisterSyncDbs() const {
+  auto* handle = InitializeAlpm();
+
+  if (handle != nullptr && !sync_dbs_registered_) {
+    for (const auto& repo : config_.repos) {
+      alpm_register_syncdb(handle, repo.c_str(),
+                           static_cast<alpm_siglevel_t>(0));
+    }
+    sync_dbs_registered_ = true;
+  }
+
+  return alpm_get_syncdbs(handle);
 }
 
 std::string Pacman::RepoForPackage(const std::string& package) const {
-  for (auto i = alpm_get_syncdbs(alpm_); i != nullptr; i = i->next) {
-    auto db = static_cast<alpm_db_t*>(i->data);
-    auto pkgcache = alpm_db_get_pkgcache(db);
+  const auto* idx = index(DbScope::ALL);
+  if (idx == nullptr) {
+    return std::string();
+  }
 
-    if (alpm_find_satisfier(pkgcache, package.c_str()) != nullptr) {
-      return alpm_db_get_name(db);
+  for (size_t db = 1; db < idx->num_dbs(); ++db) {
+    if (idx->HasSatisfier(db, package)) {
+      return std::string(idx->db_name(db));
     }
   }
 
@@ -154,35 +376,93 @@ std::string Pacman::RepoForPackage(const std::string& package) const {
 }
 
 bool Pacman::DependencyIsSatisfied(const std::string& package) const {
-  auto* cache = alpm_db_get_pkgcache(local_db_);
-  return alpm_find_satisfier(cache, package.c_str()) != nullptr;
+  const auto* idx = index(DbScope::LOCAL);
+  return idx != nullptr && idx->HasSatisfier(0, package);
 }
 
 std::optional<Pacman::Package> Pacman::GetLocalPackage(
     const std::string& name) const {
-  auto* pkg = alpm_db_get_pkg(local_db_, name.c_str());
-  if (pkg == nullptr) {
+  const auto* idx = index(DbScope::LOCAL);
+  if (idx == nullptr) {
+    return std::nullopt;
+  }
+
+  const auto pkg = idx->FindPackage(0, name);
+  if (!pkg) {
     return std::nullopt;
   }
 
-  return Package{alpm_pkg_get_name(pkg), alpm_pkg_get_version(pkg)};
+  return Package{std::string(pkg->name), std::string(pkg->version)};
 }
 
 std::vector<Pacman::Package> Pacman::LocalPackages() const {
   std::vector<Package> packages;
 
-  for (auto i = alpm_db_get_pkgcache(local_db_); i != nullptr; i = i->next) {
-    const auto pkg = static_cast<alpm_pkg_t*>(i->data);
+  const auto* idx = index(DbScope::LOCAL);
+  if (idx == nullptr) {
+    return packages;
+  }
+
+  for (const auto& pkg : idx->Packages(0)) {
+    packages.emplace_back(std::string(pkg.name), std::string(pkg.version));
+  }
+
+  return packages;
+}
+
+std::vector<Pacman::Package> Pacman::ForeignPackages(
+    bool include_ignored) const {
+  std::vector<Package> packages;
+
+  const auto* idx = index(DbScope::ALL);
+  if (idx == nullptr) {
+    return packages;
+  }
+
+  const auto in_sync_db = [idx](std::string_view pkgname) {
+    for (size_t db = 1; db < idx->num_dbs(); ++db) {
+      if (idx->FindPackage(db, pkgname)) {
+        return true;
+      }
+    }
+    return false;
+  };
 
-    packages.emplace_back(alpm_pkg_get_name(pkg), alpm_pkg_get_version(pkg));
+  for (const auto& pkg : idx->Packages(0)) {
+    if (in_sync_db(pkg.name)) {
+      continue;
+    }
+
+    if (!include_ignored && ShouldIgnore(pkg.name)) {
+      continue;
+    }
+
+    packages.emplace_back(std::string(pkg.name), std::string(pkg.version));
   }
 
   return packages;
 }
 
+bool Pacman::ShouldIgnore(std::string_view pkgname) const {
+  const std::string name(pkgname);
+
+  // Groups aren't part of the index, so IgnoreGroup still needs libalpm.
+  if (!config_.ignoregroups.empty()) {
+    auto* pkg = alpm_db_get_pkg(local_db(), name.c_str());
+    return pkg != nullptr && alpm_pkg_should_ignore(alpm(), pkg);
+  }
+
+  // As alpm_pkg_should_ignore does, ignore the package if any pattern matches
+  // it. Patterns are plain globs, with no negation.
+  return std::any_of(config_.ignorepkgs.begin(), config_.ignorepkgs.end(),
+                     [&name](const std::string& pattern) {
+                       return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+                     });
+}
+
 // static
-int Pacman::Vercmp(const std::string& a, const std::string& b) {
-  return alpm_pkg_vercmp(a.c_str(), b.c_str());
+int Pacman::Vercmp(std::string_view a, std::string_view b) {
+  return Version::Compare(a, b);
 }
 
 }  // namespace auracle
@@ -3,11 +3,15 @@
 
 #include <alpm.h>
 
+#include <future>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "pacman_index.hh"
+
 namespace auracle {
 
 class Pacman {
@@ -19,8 +23,28 @@ class Pacman {
     std::string pkgver;
   };
 
-  // Factory constructor.
-  static std::unique_ptr<Pacman> NewFromConfig(const std::string& config_file);
+  // The DBs that a caller needs to query.
+  enum class DbScope {
+    // Only the local DB, as for annotating packages with installed versions.
+    LOCAL,
+    // The local DB, and every sync DB.
+    ALL,
+  };
+
+  // The subset of pacman.conf which we care about.
+  struct Config {
+    std::string dbpath = "/var/lib/pacman";
+    std::string rootdir = "/";
+    std::vector<std::string> repos;
+    std::vector<std::string> ignorepkgs;
+    std::vector<std::string> ignoregroups;
+  };
+
+  // Factory constructor. Only parses the config; libalpm isn't initialized
+  // until first use. If |cache_dir| is non-empty, indexes of the package DBs
+  // are persisted there and reused for as long as the DBs are unchanged.
+  static std::unique_ptr<Pacman> NewFromConfig(const std::string& config_file,
+                                               const std::string& cache_dir);
 
   ~Pacman();
 
@@ -30,7 +54,15 @@ class Pacman {
   Pacman(Pacman&&) = default;
   Pacman& operator=(Pacman&&) = default;
 
-  static int Vercmp(const std::string& a, const std::string& b);
+  // Compares versions as alpm_pkg_vercmp does. See also Version, for
+  // versions which are compared repeatedly.
+  static int Vercmp(std::string_view a, std::string_view b);
+
+  // Begins loading the index of the DBs in |scope|, rebuilding it from libalpm
+  // if needed, on a background thread so that it can overlap with network
+  // requests. Any other method called in the meantime waits for the load to
+  // complete.
+  void LoadInBackground(DbScope scope);
 
   // Returns the name of the repo that the package belongs to, or empty string
   // if the package was not found in any repo.
@@ -43,13 +75,51 @@ class Pacman {
   bool DependencyIsSatisfied(const std::string& package) const;
 
   std::vector<Package> LocalPackages() const;
+
+  // Returns locally installed packages which aren't found in any sync DB, as
+  // with pacman -Qm. Packages matched by IgnorePkg or IgnoreGroup are omitted
+  // unless |include_ignored| is true.
+  std::vector<Package> ForeignPackages(bool include_ignored) const;
   std::optional<Package> GetLocalPackage(const std::string& name) const;
 
  private:
-  Pacman(alpm_handle_t* alpm);
-
-  alpm_handle_t* alpm_;
-  alpm_db_t* local_db_;
+  Pacman(Config config, std::string cache_dir);
+
+  // Accessors which lazily load a package index or initialize libalpm.
+  // Queries are answered from an index, and libalpm is only needed to
+  // rebuild one, or to resolve IgnoreGroup. Queries of the local DB alone
+  // never read or register the sync DBs, unless they're already indexed.
+  const PacmanIndex* index(DbScope scope) const;
+  alpm_handle_t* alpm() const;
+  alpm_db_t* local_db() const;
+
+  // The unsynchronized guts of the above accessors, shared with the background
+  // loader.
+  const PacmanIndex* LoadIndex(DbScope scope) const;
+  std::unique_ptr<PacmanIndex> BuildIndex(
+      DbScope scope, std::vector<PacmanIndex::DbStamp> stamps) const;
+  std::string IndexPath(DbScope scope) const;
+  alpm_handle_t* InitializeAlpm() const;
+  alpm_list_t* RegisterSyncDbs() const;
+
+  void WaitForBackgroundLoad() const;
+
+  bool ShouldIgnore(std::string_view pkgname) const;
+
+  Config config_;
+  std::string cache_dir_;
+  mutable std::future<void> background_load_;
+
+  // The index of all DBs, and that of the local DB alone. Either answers
+  // queries of the local DB.
+  mutable std::unique_ptr<PacmanIndex> index_;
+  mutable bool index_loaded_ = false;
+  mutable std::unique_ptr<PacmanIndex> local_index_;
+  mutable bool local_index_loaded_ = false;
+
+  mutable alpm_handle_t* alpm_ = nullptr;
+  mutable bool alpm_failed_ = false;
+  mutable bool sync_dbs_registered_ = false;
 };
 
 }  // namespace auracle
@@ -0,0 +1,494 @@
+#include "pacman_index.hh"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <tuple>
+#include <unordered_map>
+
+#include "pacman.hh"
+
+namespace fs = std::filesystem;
+
+namespace auracle {
+
+// The serialized index is laid out as:
+//
+//   Header | DbRecord[num_dbs] | PackageRecord[num_packages] |
+//   ProvideRecord[num_provides] | strings
+//
+// Strings are NUL terminated and referenced by their offset into the string
+// table. Offset 0 is always the empty string. Each DB owns a contiguous run of
+// packages and provides, both sorted by name, so lookups are a binary search
+// directly over the mapped file. Integers are stored in host byte order; the
+// index is a local cache, not an interchange format.
+struct PacmanIndex::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_dbs;
+  uint32_t num_packages;
+  uint32_t num_provides;
+  uint32_t strings_size;
+  uint32_t reserved;
+};
+
+struct PacmanIndex::DbRecord {
+  uint32_t name;
+  uint32_t path;
+  int64_t mtime_ns;
+  uint64_t size;
+  uint32_t first_package;
+  uint32_t num_packages;
+  uint32_t first_provide;
+  uint32_t num_provides;
+};
+
+struct PacmanIndex::PackageRecord {
+  uint32_t name;
+  uint32_t version;
+};
+
+struct PacmanIndex::ProvideRecord {
+  uint32_t name;
+  uint32_t version;
+};
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'U', 'R', 'A', 'C', 'I', 'D', 'X'};
+constexpr uint32_t kFormatVersion = 1;
+
+template <typename T>
+void Append(std::string* out, const T& value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+class StringTable {
+ public:
+  StringTable() { data_.push_back('\0'); }
+
+  uint32_t Intern(std::string_view s) {
+    if (s.empty()) {
+      return 0;
+    }
+
+    auto [iter, inserted] = offsets_.emplace(s, data_.size());
+    if (inserted) {
+      data_.append(s).push_back('\0');
+    }
+
+    return iter->second;
+  }
+
+  const std::string& data() const { return data_; }
+
+ private:
+  std::string data_;
+  std::unordered_map<std::string, uint32_t> offsets_;
+};
+
+enum class DepMod { ANY, EQ, GE, LE, GT, LT };
+
+struct Dependency {
+  std::string_view name;
+  DepMod mod = DepMod::ANY;
+  std::string_view version;
+};
+
+Dependency ParseDepstring(std::string_view depstring) {
+  Dependency dep;
+
+  const auto n = depstring.find_first_of("<>=");
+  dep.name = depstring.substr(0, n);
+  if (n == std::string_view::npos) {
+    return dep;
+  }
+
+  auto op = depstring.substr(n);
+  if (op.substr(0, 2) == ">=") {
+    dep.mod = DepMod::GE;
+  } else if (op.substr(0, 2) == "<=") {
+    dep.mod = DepMod::LE;
+  } else if (op[0] == '=') {
+    dep.mod = DepMod::EQ;
+  } else if (op[0] == '>') {
+    dep.mod = DepMod::GT;
+  } else {
+    dep.mod = DepMod::LT;
+  }
+
+  op.remove_prefix(dep.mod == DepMod::GE || dep.mod == DepMod::LE ? 2 : 1);
+  dep.version = op;
+
+  return dep;
+}
+
+bool VersionSatisfies(const Dependency& dep, std::string_view version) {
+  if (dep.mod == DepMod::ANY) {
+    return true;
+  }
+
+  const int cmp = Pacman::Vercmp(version, dep.version);
+  switch (dep.mod) {
+    case DepMod::EQ:
+      return cmp == 0;
+    case DepMod::GE:
+      return cmp >= 0;
+    case DepMod::LE:
+      return cmp <= 0;
+    case DepMod::GT:
+      return cmp > 0;
+    case DepMod::LT:
+      return cmp < 0;
+    case DepMod::ANY:
+      break;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+// static
+PacmanIndex::DbStamp PacmanIndex::DbStamp::ForPath(std::string name,
+                                                   std::string path) {
+  DbStamp stamp;
+
+  // A missing DB is still a state worth remembering: it'll get a new stamp as
+  // soon as it shows up.
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) {
+    stamp.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+                     st.st_mtim.tv_nsec;
+    stamp.size = st.st_size;
+  }
+
+  stamp.name = std::move(name);
+  stamp.path = std::move(path);
+
+  return stamp;
+}
+
+PacmanIndex::Builder::Builder(std::vector<DbStamp> dbs)
+    : dbs_(std::move(dbs)), packages_(dbs_.size()) {}
+
+void PacmanIndex::Builder::AddPackage(
+    size_t db, std::string_view name, std::string_view version,
+    const std::vector<std::string>& provides) {
+  packages_[db].push_back(
+      PackageEntry{std::string(name), std::string(version), provides});
+}
+
+std::string PacmanIndex::Builder::Serialize() const {
+  StringTable strings;
+  std::vector<DbRecord> dbs;
+  std::vector<PackageRecord> packages;
+  std::vector<ProvideRecord> provides;
+
+  for (size_t i = 0; i < dbs_.size(); ++i) {
+    DbRecord db{};
+    db.name = strings.Intern(dbs_[i].name);
+    db.path = strings.Intern(dbs_[i].path);
+    db.mtime_ns = dbs_[i].mtime_ns;
+    db.size = dbs_[i].size;
+
+    std::vector<std::tuple<std::string_view, std::string_view>> pkgs;
+    std::vector<std::tuple<std::string_view, std::string_view>> provs;
+    for (const auto& entry : packages_[i]) {
+      pkgs.emplace_back(entry.name, entry.version);
+
+      for (std::string_view provide : entry.provides) {
+        // Provides only ever carry an exact version, if any.
+        const auto n = provide.find('=');
+        provs.emplace_back(provide.substr(0, n),
+                           n == std::string_view::npos
+                               ? std::string_view()
+                               : provide.substr(n + 1));
+      }
+    }
+
+    std::sort(pkgs.begin(), pkgs.end());
+    std::sort(provs.begin(), provs.end());
+    provs.erase(std::unique(provs.begin(), provs.end()), provs.end());
+
+    db.first_package = packages.size();
+    db.num_packages = pkgs.size();
+    for (const auto& [name, version] : pkgs) {
+      packages.push_back({strings.Intern(name), strings.Intern(version)});
+    }
+
+    db.first_provide = provides.size();
+    db.num_provides = provs.size();
+    for (const auto& [name, version] : provs) {
+      provides.push_back({strings.Intern(name), strings.Intern(version)});
+    }
+
+    dbs.push_back(db);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFormatVersion;
+  header.num_dbs = dbs.size();
+  header.num_packages = packages.size();
+  header.num_provides = provides.size();
+  header.strings_size = strings.data().size();
+
+  std::string out;
+  out.reserve(sizeof(header) + dbs.size() * sizeof(DbRecord) +
+              (packages.size() + provides.size()) * sizeof(PackageRecord) +
+              strings.data().size());
+
+  Append(&out, header);
+  for (const auto& db : dbs) {
+    Append(&out, db);
+  }
+  for (const auto& package : packages) {
+    Append(&out, package);
+  }
+  for (const auto& provide : provides) {
+    Append(&out, provide);
+  }
+  out.append(strings.data());
+
+  return out;
+}
+
+// static
+std::unique_ptr<PacmanIndex> PacmanIndex::Open(
+    const std::string& path, const std::vector<DbStamp>& expected) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::unique_ptr<PacmanIndex> index(new PacmanIndex);
+  index->mapping_ = mapping;
+  index->data_ = static_cast<const char*>(mapping);
+  index->size_ = st.st_size;
+
+  if (!index->Validate() || index->num_dbs() != expected.size()) {
+    return nullptr;
+  }
+
+  for (size_t i = 0; i < expected.size(); ++i) {
+    const auto& db = index->dbs()[i];
+    const DbStamp stamp{std::string(index->String(db.name)),
+                        std::string(index->String(db.path)), db.mtime_ns,
+                        db.size};
+    if (!(stamp == expected[i])) {
+      return nullptr;
+    }
+  }
+
+  return index;
+}
+
+// static
+std::unique_ptr<PacmanIndex> PacmanIndex::FromBytes(std::string bytes) {
+  std::unique_ptr<PacmanIndex> index(new PacmanIndex);
+  index->bytes_ = std::move(bytes);
+  index->data_ = index->bytes_.data();
+  index->size_ = index->bytes_.size();
+
+  if (!index->Validate()) {
+    return nullptr;
+  }
+
+  return index;
+}
+
+// static
+bool PacmanIndex::Write(const std::string& path, const std::string& bytes) {
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+  if (ec) {
+    return false;
+  }
+
+  // Each writer gets a file of its own, so that concurrent runs can't write
+  // over each other before the rename.
+  std::string tmp = path + ".XXXXXX";
+  const int fd = mkstemp(tmp.data());
+  if (fd < 0) {
+    return false;
+  }
+
+  for (size_t written = 0; written < bytes.size();) {
+    const ssize_t n =
+        write(fd, bytes.data() + written, bytes.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      unlink(tmp.c_str());
+      return false;
+    }
+    written += n;
+  }
+
+  if (close(fd) < 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+PacmanIndex::~PacmanIndex() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, size_);
+  }
+}
+
+bool PacmanIndex::Validate() {
+  if (size_ < sizeof(Header)) {
+    return false;
+  }
+
+  const auto& h = header();
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 ||
+      h.version != kFormatVersion) {
+    return false;
+  }
+
+  const uint64_t expected_size =
+      sizeof(Header) + uint64_t{h.num_dbs} * sizeof(DbRecord) +
+      uint64_t{h.num_packages} * sizeof(PackageRecord) +
+      uint64_t{h.num_provides} * sizeof(ProvideRecord) + h.strings_size;
+  if (expected_size != size_ || h.strings_size == 0 ||
+      data_[size_ - 1] != '\0') {
+    return false;
+  }
+
+  for (size_t i = 0; i < h.num_dbs; ++i) {
+    const auto& db = dbs()[i];
+    if (uint64_t{db.first_package} + db.num_packages > h.num_packages ||
+        uint64_t{db.first_provide} + db.num_provides > h.num_provides) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const PacmanIndex::Header& PacmanIndex::header() const {
+  return *reinterpret_cast<const Header*>(data_);
+}
+
+const PacmanIndex::DbRecord* PacmanIndex::dbs() const {
+  return reinterpret_cast<const DbRecord*>(data_ + sizeof(Header));
+}
+
+const PacmanIndex::PackageRecord* PacmanIndex::packages() const {
+  return reinterpret_cast<const PackageRecord*>(dbs() + header().num_dbs);
+}
+
+const PacmanIndex::ProvideRecord* PacmanIndex::provides() const {
+  return reinterpret_cast<const ProvideRecord*>(packages() +
+                                                header().num_packages);
+}
+
+std::string_view PacmanIndex::String(uint32_t offset) const {
+  if (offset >= header().strings_size) {
+    return std::string_view();
+  }
+
+  // Validate() guarantees the table ends with a NUL.
+  const auto* strings =
+      reinterpret_cast<const char*>(provides() + header().num_provides);
+  return std::string_view(strings + offset);
+}
+
+size_t PacmanIndex::num_dbs() const { return header().num_dbs; }
+
+std::string_view PacmanIndex::db_name(size_t db) const {
+  return String(dbs()[db].name);
+}
+
+std::vector<PacmanIndex::Package> PacmanIndex::Packages(size_t db) const {
+  const auto& record = dbs()[db];
+  const auto* begin = packages() + record.first_package;
+
+  std::vector<Package> result;
+  result.reserve(record.num_packages);
+  for (auto* p = begin; p != begin + record.num_packages; ++p) {
+    result.push_back({String(p->name), String(p->version)});
+  }
+
+  return result;
+}
+
+std::optional<PacmanIndex::Package> PacmanIndex::FindPackage(
+    size_t db, std::string_view name) const {
+  const auto& record = dbs()[db];
+  const auto* begin = packages() + record.first_package;
+  const auto* end = begin + record.num_packages;
+
+  const auto* iter = std::lower_bound(
+      begin, end, name, [this](const PackageRecord& p, std::string_view name) {
+        return String(p.name) < name;
+      });
+  if (iter == end || String(iter->name) != name) {
+    return std::nullopt;
+  }
+
+  return Package{String(iter->name), String(iter->version)};
+}
+
+bool PacmanIndex::HasSatisfier(size_t db, std::string_view depstring) const {
+  const auto dep = ParseDepstring(depstring);
+
+  if (auto package = FindPackage(db, dep.name);
+      package && VersionSatisfies(dep, package->version)) {
+    return true;
+  }
+
+  const auto& record = dbs()[db];
+  const auto* begin = provides() + record.first_provide;
+  const auto* end = begin + record.num_provides;
+
+  auto* iter = std::lower_bound(
+      begin, end, dep.name,
+      [this](const ProvideRecord& p, std::string_view name) {
+        return String(p.name) < name;
+      });
+  for (; iter != end && String(iter->name) == dep.name; ++iter) {
+    // An unversioned provide can't satisfy a versioned dependency.
+    const auto version = String(iter->version);
+    if (dep.mod == DepMod::ANY ||
+        (!version.empty() && VersionSatisfies(dep, version))) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace auracle
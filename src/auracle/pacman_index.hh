@@ -0,0 +1,117 @@
+#ifndef AURACLE_PACMAN_INDEX_HH_
+#define AURACLE_PACMAN_INDEX_HH_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace auracle {
+
+// A compact snapshot of the package DBs that auracle consults: the names,
+// versions and provides of every package, grouped by DB. The serialized form
+// is designed to be mapped and queried in place, so that loading it costs the
+// same regardless of how many packages are installed.
+class PacmanIndex {
+ public:
+  // Identifies the on-disk state of a single DB. An index is only valid for
+  // the exact list of stamps that it was built from.
+  struct DbStamp {
+    static DbStamp ForPath(std::string name, std::string path);
+
+    bool operator==(const DbStamp& other) const {
+      return name == other.name && path == other.path &&
+             mtime_ns == other.mtime_ns && size == other.size;
+    }
+
+    std::string name;
+    std::string path;
+    int64_t mtime_ns = 0;
+    uint64_t size = 0;
+  };
+
+  struct Package {
+    std::string_view name;
+    std::string_view version;
+  };
+
+  class Builder {
+   public:
+    explicit Builder(std::vector<DbStamp> dbs);
+
+    // |provides| are given as depstrings, e.g. "libfoo.so=1-64".
+    void AddPackage(size_t db, std::string_view name, std::string_view version,
+                    const std::vector<std::string>& provides);
+
+    std::string Serialize() const;
+
+   private:
+    struct PackageEntry {
+      std::string name;
+      std::string version;
+      std::vector<std::string> provides;
+    };
+
+    std::vector<DbStamp> dbs_;
+    std::vector<std::vector<PackageEntry>> packages_;
+  };
+
+  // Maps the index at |path|. Returns nullptr if the file is missing,
+  // malformed, or was built from anything other than |expected|.
+  static std::unique_ptr<PacmanIndex> Open(
+      const std::string& path, const std::vector<DbStamp>& expected);
+
+  // Wraps an index which was built in memory.
+  static std::unique_ptr<PacmanIndex> FromBytes(std::string bytes);
+
+  // Atomically replaces the index at |path| with |bytes|.
+  static bool Write(const std::string& path, const std::string& bytes);
+
+  ~PacmanIndex();
+
+  PacmanIndex(const PacmanIndex&) = delete;
+  PacmanIndex& operator=(const PacmanIndex&) = delete;
+
+  PacmanIndex(PacmanIndex&&) = delete;
+  PacmanIndex& operator=(PacmanIndex&&) = delete;
+
+  size_t num_dbs() const;
+  std::string_view db_name(size_t db) const;
+
+  // Returns all packages in the DB, sorted by name.
+  std::vector<Package> Packages(size_t db) const;
+  std::optional<Package> FindPackage(size_t db, std::string_view name) const;
+
+  // Returns true if any package in the DB satisfies the dependency, either by
+  // name or through its provides, as with alpm_find_satisfier.
+  bool HasSatisfier(size_t db, std::string_view depstring) const;
+
+ private:
+  struct Header;
+  struct DbRecord;
+  struct PackageRecord;
+  struct ProvideRecord;
+
+  PacmanIndex() = default;
+
+  bool Validate();
+
+  const Header& header() const;
+  const DbRecord* dbs() const;
+  const PackageRecord* packages() const;
+  const ProvideRecord* provides() const;
+  std::string_view String(uint32_t offset) const;
+
+  // Exactly one of these backs |data_|.
+  std::string bytes_;
+  void* mapping_ = nullptr;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace auracle
+
+#endif  // AURACLE_PACMAN_INDEX_HH_
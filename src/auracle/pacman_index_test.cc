@@ -0,0 +1,141 @@
+#include "pacman_index.hh"
+
+#include <unistd.h>
+
+#include <filesystem>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using auracle::PacmanIndex;
+
+namespace {
+
+std::vector<PacmanIndex::DbStamp> Stamps() {
+  return {
+      {"local", "/var/lib/pacman/local", 1000, 4096},
+      {"core", "/var/lib/pacman/sync/core.db", 2000, 123456},
+      {"extra", "/var/lib/pacman/sync/extra.db", 3000, 654321},
+  };
+}
+
+std::string BuildIndex() {
+  PacmanIndex::Builder builder(Stamps());
+
+  builder.AddPackage(0, "pacman", "5.2.1-1", {"libalpm.so=12-64"});
+  builder.AddPackage(0, "auracle-git", "r74.82e863f-1", {"auracle"});
+  builder.AddPackage(0, "glibc", "2.31-2", {});
+
+  builder.AddPackage(1, "pacman", "5.2.2-1", {"libalpm.so=12-64"});
+  builder.AddPackage(1, "glibc", "2.31-2", {});
+  builder.AddPackage(2, "python", "3.8.2-1", {"python3=3.8.2"});
+
+  return builder.Serialize();
+}
+
+std::vector<std::string> Names(const std::vector<PacmanIndex::Package>& p) {
+  std::vector<std::string> names;
+  for (const auto& package : p) {
+    names.emplace_back(package.name);
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST(PacmanIndexTest, FindsPackages) {
+  const auto index = PacmanIndex::FromBytes(BuildIndex());
+  ASSERT_NE(index, nullptr);
+
+  ASSERT_EQ(index->num_dbs(), 3);
+  EXPECT_EQ(index->db_name(0), "local");
+  EXPECT_EQ(index->db_name(2), "extra");
+
+  EXPECT_THAT(Names(index->Packages(0)),
+              testing::ElementsAre("auracle-git", "glibc", "pacman"));
+  EXPECT_THAT(Names(index->Packages(2)), testing::ElementsAre("python"));
+
+  const auto pacman = index->FindPackage(1, "pacman");
+  ASSERT_TRUE(pacman.has_value());
+  EXPECT_EQ(pacman->version, "5.2.2-1");
+
+  EXPECT_FALSE(index->FindPackage(1, "auracle-git").has_value());
+  EXPECT_FALSE(index->FindPackage(0, "").has_value());
+}
+
+TEST(PacmanIndexTest, FindsSatisfiers) {
+  const auto index = PacmanIndex::FromBytes(BuildIndex());
+  ASSERT_NE(index, nullptr);
+
+  // By name.
+  EXPECT_TRUE(index->HasSatisfier(0, "pacman"));
+  EXPECT_TRUE(index->HasSatisfier(0, "pacman>=5.2"));
+  EXPECT_FALSE(index->HasSatisfier(0, "pacman>5.2.1-1"));
+  EXPECT_TRUE(index->HasSatisfier(1, "pacman>5.2.1-1"));
+
+  // By provides.
+  EXPECT_TRUE(index->HasSatisfier(0, "auracle"));
+  EXPECT_TRUE(index->HasSatisfier(0, "libalpm.so=12-64"));
+  EXPECT_TRUE(index->HasSatisfier(2, "python3<=3.8.2"));
+  EXPECT_FALSE(index->HasSatisfier(2, "python3<3.8.2"));
+
+  // Unversioned provides can't satisfy versioned dependencies.
+  EXPECT_FALSE(index->HasSatisfier(0, "auracle>=1"));
+
+  EXPECT_FALSE(index->HasSatisfier(0, "python"));
+}
+
+TEST(PacmanIndexTest, RejectsMalformedIndexes) {
+  auto bytes = BuildIndex();
+
+  EXPECT_EQ(PacmanIndex::FromBytes(""), nullptr);
+  EXPECT_EQ(PacmanIndex::FromBytes(bytes.substr(0, bytes.size() - 1)),
+            nullptr);
+
+  bytes[0] = 'X';
+  EXPECT_EQ(PacmanIndex::FromBytes(bytes), nullptr);
+}
+
+TEST(PacmanIndexTest, OnlyOpensIndexesForMatchingStamps) {
+  char tmpdir[] = "/tmp/pacman_index_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = std::string(tmpdir) + "/cache/pacman.idx";
+
+  EXPECT_EQ(PacmanIndex::Open(path, Stamps()), nullptr);
+
+  ASSERT_TRUE(PacmanIndex::Write(path, BuildIndex()));
+
+  {
+    const auto index = PacmanIndex::Open(path, Stamps());
+    ASSERT_NE(index, nullptr);
+    EXPECT_TRUE(index->FindPackage(2, "python").has_value());
+  }
+
+  auto stamps = Stamps();
+  stamps[1].mtime_ns += 1;
+  EXPECT_EQ(PacmanIndex::Open(path, stamps), nullptr);
+
+  stamps = Stamps();
+  stamps.pop_back();
+  EXPECT_EQ(PacmanIndex::Open(path, stamps), nullptr);
+
+  std::filesystem::remove_all(tmpdir);
+}
+
+TEST(PacmanIndexTest, WritesLeaveNoTemporaryFiles) {
+  char tmpdir[] = "/tmp/pacman_index_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = std::string(tmpdir) + "/pacman.idx";
+
+  ASSERT_TRUE(PacmanIndex::Write(path, BuildIndex()));
+  ASSERT_TRUE(PacmanIndex::Write(path, BuildIndex()));
+
+  std::vector<std::string> files;
+  for (const auto& entry : std::filesystem::directory_iterator(tmpdir)) {
+    files.push_back(entry.path().filename());
+  }
+  EXPECT_THAT(files, testing::ElementsAre("pacman.idx"));
+  EXPECT_NE(PacmanIndex::Open(path, Stamps()), nullptr);
+
+  std::filesystem::remove_all(tmpdir);
+}
@@ -0,0 +1,75 @@
+#include "result_stream.hh"
+
+#include <algorithm>
+#include <queue>
+
+#include "aur/profiler.hh"
+#include "format.hh"
+
+namespace auracle {
+
+void ResultStream::Emit(const aur::Package& package) {
+  if (seen_.insert(package.package_id).second) {
+    aur::Profiler::Scope scope(aur::Profiler::Phase::FORMAT);
+    print_(package);
+  }
+}
+
+void ResultStream::Add(std::vector<aur::Package> packages) {
+  if (sorter_ == nullptr) {
+    for (const auto& p : packages) {
+      Emit(p);
+    }
+
+    // Don't sit on output that we could be showing while the remaining
+    // requests finish.
+    format::Flush();
+    return;
+  }
+
+  aur::Profiler::Scope scope(aur::Profiler::Phase::SORT);
+  std::stable_sort(packages.begin(), packages.end(), sorter_);
+  runs_.push_back(std::move(packages));
+}
+
+void ResultStream::Finish() {
+  aur::Profiler::Scope scope(aur::Profiler::Phase::SORT);
+
+  // The head of each run, as (run, offset). The heap keeps the run whose head
+  // sorts first on top, breaking ties by run so that output is deterministic.
+  using Cursor = std::pair<size_t, size_t>;
+  const auto cmp = [this](const Cursor& a, const Cursor& b) {
+    const auto& pa = runs_[a.first][a.second];
+    const auto& pb = runs_[b.first][b.second];
+    if (sorter_(pb, pa)) {
+      return true;
+    }
+    if (sorter_(pa, pb)) {
+      return false;
+    }
+    return a.first > b.first;
+  };
+
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(cmp)> heads(cmp);
+  for (size_t i = 0; i < runs_.size(); ++i) {
+    if (!runs_[i].empty()) {
+      heads.emplace(i, 0);
+    }
+  }
+
+  while (!heads.empty()) {
+    auto [run, offset] = heads.top();
+    heads.pop();
+
+    Emit(runs_[run][offset]);
+
+    if (++offset < runs_[run].size()) {
+      heads.emplace(run, offset);
+    }
+  }
+
+  runs_.clear();
+  format::Flush();
+}
+
+}  // namespace auracle
@@ -0,0 +1,58 @@
+#ifndef AURACLE_RESULT_STREAM_HH_
+#define AURACLE_RESULT_STREAM_HH_
+
+#include <functional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "aur/package.hh"
+#include "sort.hh"
+
+namespace auracle {
+
+// Collects the results of one or more RPC responses and hands each unique
+// package to a printer. Without a sorter, packages are printed as soon as
+// their response arrives. With one, each response is sorted as it arrives and
+// the sorted runs are merged once the last response is in, which avoids
+// concatenating and re-sorting everything at the end.
+class ResultStream {
+ public:
+  using PrintFn = std::function<void(const aur::Package&)>;
+
+  ResultStream(sort::Sorter sorter, PrintFn print)
+      : sorter_(std::move(sorter)), print_(std::move(print)) {}
+  ~ResultStream() = default;
+
+  ResultStream(const ResultStream&) = delete;
+  ResultStream& operator=(const ResultStream&) = delete;
+
+  ResultStream(ResultStream&&) = default;
+  ResultStream& operator=(ResultStream&&) = default;
+
+  void Add(std::vector<aur::Package> packages);
+
+  // Prints anything still held back. Must be called after the last Add.
+  void Finish();
+
+  // The number of unique packages printed so far.
+  int size() const { return seen_.size(); }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  void Emit(const aur::Package& package);
+
+  sort::Sorter sorter_;
+  PrintFn print_;
+
+  std::vector<std::vector<aur::Package>> runs_;
+
+  // Large queries are split across requests, and searches for multiple terms
+  // frequently overlap, so the same package may show up more than once.
+  std::unordered_set<int> seen_;
+};
+
+}  // namespace auracle
+
+#endif  // AURACLE_RESULT_STREAM_HH_
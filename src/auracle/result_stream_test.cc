@@ -0,0 +1,64 @@
+#include "result_stream.hh"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+
+namespace {
+
+aur::Package MakePackage(int id, std::string name, int votes) {
+  aur::Package p;
+  p.package_id = id;
+  p.name = std::move(name);
+  p.votes = votes;
+  return p;
+}
+
+}  // namespace
+
+TEST(ResultStreamTest, PrintsUnsortedResultsAsTheyArrive) {
+  std::vector<std::string> printed;
+  auracle::ResultStream stream(
+      nullptr, [&](const aur::Package& p) { printed.push_back(p.name); });
+
+  stream.Add({MakePackage(1, "cower", 10), MakePackage(2, "auracle", 20)});
+  EXPECT_THAT(printed, ElementsAre("cower", "auracle"));
+
+  stream.Add({MakePackage(2, "auracle", 20), MakePackage(3, "pkgfile", 5)});
+  EXPECT_THAT(printed, ElementsAre("cower", "auracle", "pkgfile"));
+
+  stream.Finish();
+  EXPECT_EQ(stream.size(), 3);
+}
+
+TEST(ResultStreamTest, MergesSortedResults) {
+  std::vector<std::string> printed;
+  auracle::ResultStream stream(
+      sort::MakePackageSorter("votes", sort::OrderBy::ORDER_DESC),
+      [&](const aur::Package& p) { printed.push_back(p.name); });
+
+  stream.Add({MakePackage(1, "cower", 10), MakePackage(2, "auracle", 20)});
+  stream.Add({});
+  stream.Add({MakePackage(3, "pkgfile", 5), MakePackage(2, "auracle", 20),
+              MakePackage(4, "expac", 15)});
+  EXPECT_TRUE(printed.empty());
+
+  stream.Finish();
+  EXPECT_THAT(printed, ElementsAre("auracle", "expac", "cower", "pkgfile"));
+  EXPECT_EQ(stream.size(), 4);
+}
+
+TEST(ResultStreamTest, ReportsNoResults) {
+  auracle::ResultStream stream(
+      sort::MakePackageSorter("name", sort::OrderBy::ORDER_ASC),
+      [](const aur::Package&) {});
+
+  stream.Add({});
+  stream.Finish();
+
+  EXPECT_TRUE(stream.empty());
+}
@@ -1,7 +1,11 @@
 #include "sort.hh"
 
+#include <memory>
+#include <string>
 #include <unordered_map>
 
+#include "version.hh"
+
 namespace sort {
 
 template <typename T>
@@ -20,6 +24,38 @@ Sorter MakePackageSorter(T aur::Package::*field, OrderBy order_by) {
   return nullptr;
 }
 
+Sorter MakeVersionSorter(OrderBy order_by) {
+  // Sorting compares each version many times over, so parse each distinct
+  // version only once.
+  auto cache = std::make_shared<
+      std::unordered_map<std::string, auracle::Version>>();
+  auto compare = [cache](const aur::Package& a, const aur::Package& b) {
+    const auto key = [&cache](const std::string& version)
+        -> const auracle::Version& {
+      auto iter = cache->find(version);
+      if (iter == cache->end()) {
+        iter = cache->emplace(version, auracle::Version(version)).first;
+      }
+      return iter->second;
+    };
+
+    return auracle::Version::CompareForSort(key(a.version), key(b.version));
+  };
+
+  switch (order_by) {
+    case OrderBy::ORDER_ASC:
+      return [=](const aur::Package& a, const aur::Package& b) {
+        return compare(a, b) < 0;
+      };
+    case OrderBy::ORDER_DESC:
+      return [=](const aur::Package& a, const aur::Package& b) {
+        return compare(a, b) > 0;
+      };
+  }
+
+  return nullptr;
+}
+
 Sorter MakePackageSorter(std::string_view field, OrderBy order_by) {
   if (field == "name") {
     return MakePackageSorter(&aur::Package::name, order_by);
@@ -41,6 +77,10 @@ Sorter MakePackageSorter(std::string_view field, OrderBy order_by) {
     return MakePackageSorter(&aur::Package::modified, order_by);
   }
 
+  if (field == "version") {
+    return MakeVersionSorter(order_by);
+  }
+
   return nullptr;
 }
 
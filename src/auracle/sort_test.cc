@@ -25,6 +25,7 @@ std::vector<aur::Package> MakePackages() {
   {
     auto& p = packages.emplace_back();
     p.name = "cower";
+    p.version = "10-1";
     p.popularity = 1.2345;
     p.votes = 30;
     p.submitted = 10000s;
@@ -33,6 +34,7 @@ std::vector<aur::Package> MakePackages() {
   {
     auto& p = packages.emplace_back();
     p.name = "auracle";
+    p.version = "9.1-2";
     p.popularity = 5.3241;
     p.votes = 20;
     p.submitted = 20000s;
@@ -41,6 +43,7 @@ std::vector<aur::Package> MakePackages() {
   {
     auto& p = packages.emplace_back();
     p.name = "pacman";
+    p.version = "1:1-1";
     p.popularity = 5.3240;
     p.votes = 10;
     p.submitted = 30000s;
@@ -107,6 +110,29 @@ TEST_P(SortOrderTest, ByLastModified) {
                            Field(&aur::Package::modified, 40000s)));
 }
 
+TEST_P(SortOrderTest, ByVersion) {
+  ExpectSorted("version", ElementsAre(Field(&aur::Package::version, "9.1-2"),
+                                      Field(&aur::Package::version, "10-1"),
+                                      Field(&aur::Package::version, "1:1-1")));
+}
+
+TEST_P(SortOrderTest, ByVersionWithoutPkgrel) {
+  std::vector<aur::Package> packages(3);
+  packages[0].version = "1.0-2";
+  packages[1].version = "1.0";
+  packages[2].version = "1.0-1";
+
+  std::sort(packages.begin(), packages.end(),
+            sort::MakePackageSorter("version", GetParam()));
+  if (GetParam() == sort::OrderBy::ORDER_DESC) {
+    std::reverse(packages.begin(), packages.end());
+  }
+
+  EXPECT_THAT(packages, ElementsAre(Field(&aur::Package::version, "1.0"),
+                                    Field(&aur::Package::version, "1.0-1"),
+                                    Field(&aur::Package::version, "1.0-2")));
+}
+
 INSTANTIATE_TEST_CASE_P(BothOrderings, SortOrderTest,
                         testing::Values(sort::OrderBy::ORDER_ASC,
                                         sort::OrderBy::ORDER_DESC),
@@ -3,33 +3,42 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 
-#include <sstream>
-#include <string>
-
 namespace terminal {
 
 namespace {
 constexpr int kDefaultColumns = 80;
 int g_cached_columns = -1;
 WantColor g_want_color = WantColor::AUTO;
+}  // namespace
 
-std::string Color(const std::string& s, const char* color) {
+std::string_view StartColor(Color color) {
   if (g_want_color == WantColor::NO) {
-    return s;
+    return std::string_view();
+  }
+
+  switch (color) {
+    case Color::BOLD:
+      return "\033[1m";
+    case Color::BOLD_CYAN:
+      return "\033[1;36m";
+    case Color::BOLD_GREEN:
+      return "\033[1;32m";
+    case Color::BOLD_MAGENTA:
+      return "\033[1;35m";
+    case Color::BOLD_RED:
+      return "\033[1;31m";
   }
 
-  std::stringstream ss;
-  ss << color << s << "\033[0m";
-  return ss.str();
+  return std::string_view();
 }
 
-}  // namespace
+std::string_view ResetColor() {
+  if (g_want_color == WantColor::NO) {
+    return std::string_view();
+  }
 
-std::string Bold(const std::string& s) { return Color(s, "\033[1m"); }
-std::string BoldRed(const std::string& s) { return Color(s, "\033[1;31m"); }
-std::string BoldCyan(const std::string& s) { return Color(s, "\033[1;36m"); }
-std::string BoldGreen(const std::string& s) { return Color(s, "\033[1;32m"); }
-std::string BoldMagenta(const std::string& s) { return Color(s, "\033[1;35m"); }
+  return "\033[0m";
+}
 
 void Init(WantColor want) {
   if (want == WantColor::AUTO) {
@@ -1,8 +1,10 @@
 #ifndef AURACLE_TERMINAL_HH_
 #define AURACLE_TERMINAL_HH_
 
-#include <sstream>
-#include <string>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <string_view>
 
 namespace terminal {
 
@@ -12,16 +14,58 @@ enum class WantColor : short {
   AUTO,
 };
 
+enum class Color : short {
+  BOLD,
+  BOLD_CYAN,
+  BOLD_GREEN,
+  BOLD_MAGENTA,
+  BOLD_RED,
+};
+
+// Text to be written in color. The escape codes are written around the text
+// as it's formatted, rather than being spliced into a new string.
+struct Colored {
+  std::string_view text;
+  Color color;
+};
+
 void Init(WantColor);
 
 int Columns();
 
-std::string Bold(const std::string& s);
-std::string BoldCyan(const std::string& s);
-std::string BoldGreen(const std::string& s);
-std::string BoldMagenta(const std::string& s);
-std::string BoldRed(const std::string& s);
+// Returns the escape sequence which starts or resets a color, or an empty
+// string if color is disabled.
+std::string_view StartColor(Color color);
+std::string_view ResetColor();
+
+inline Colored Bold(std::string_view s) { return {s, Color::BOLD}; }
+inline Colored BoldCyan(std::string_view s) { return {s, Color::BOLD_CYAN}; }
+inline Colored BoldGreen(std::string_view s) { return {s, Color::BOLD_GREEN}; }
+inline Colored BoldMagenta(std::string_view s) {
+  return {s, Color::BOLD_MAGENTA};
+}
+inline Colored BoldRed(std::string_view s) { return {s, Color::BOLD_RED}; }
 
 }  // namespace terminal
 
+FMT_BEGIN_NAMESPACE
+
+template <>
+struct formatter<terminal::Colored> : formatter<std::string_view> {
+  auto format(const terminal::Colored& c, fmt::format_context& ctx) {
+    const auto start = terminal::StartColor(c.color);
+    if (start.empty()) {
+      return formatter<std::string_view>::format(c.text, ctx);
+    }
+
+    ctx.advance_to(std::copy(start.begin(), start.end(), ctx.out()));
+    auto out = formatter<std::string_view>::format(c.text, ctx);
+
+    const auto reset = terminal::ResetColor();
+    return std::copy(reset.begin(), reset.end(), out);
+  }
+};
+
+FMT_END_NAMESPACE
+
 #endif  // AURACLE_TERMINAL_HH_
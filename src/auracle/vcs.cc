@@ -0,0 +1,376 @@
+#include "vcs.hh"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace auracle {
+
+namespace {
+
+using Vcs = aur::VcsHeadRequest::Vcs;
+
+constexpr std::string_view kWhitespace = " \t\r\n";
+
+std::string_view Trim(std::string_view sv) {
+  const auto begin = sv.find_first_not_of(kWhitespace);
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
+
+  const auto end = sv.find_last_not_of(kWhitespace);
+  return sv.substr(begin, end - begin + 1);
+}
+
+bool ConsumePrefix(std::string_view* view, std::string_view prefix) {
+  if (view->substr(0, prefix.size()) != prefix) {
+    return false;
+  }
+
+  view->remove_prefix(prefix.size());
+  return true;
+}
+
+bool EndsWith(std::string_view s, std::string_view suffix) {
+  return s.size() >= suffix.size() &&
+         s.substr(s.size() - suffix.size()) == suffix;
+}
+
+std::vector<std::string_view> Split(std::string_view s,
+                                    std::string_view delims) {
+  std::vector<std::string_view> pieces;
+
+  while (!s.empty()) {
+    const auto n = s.find_first_of(delims);
+    pieces.push_back(s.substr(0, n));
+    if (n == std::string_view::npos) {
+      break;
+    }
+    s.remove_prefix(n + 1);
+  }
+
+  return pieces;
+}
+
+std::optional<VcsSource> ParseVcsSource(std::string_view source) {
+  // Sources may be given a local name, e.g. name::git+https://...
+  if (auto n = source.find("::"); n != std::string_view::npos) {
+    source.remove_prefix(n + 2);
+  }
+
+  VcsSource vcs_source;
+  if (ConsumePrefix(&source, "git+")) {
+    vcs_source.vcs = Vcs::GIT;
+  } else if (source.substr(0, 6) == "git://") {
+    vcs_source.vcs = Vcs::GIT;
+  } else if (ConsumePrefix(&source, "hg+")) {
+    vcs_source.vcs = Vcs::HG;
+  } else if (ConsumePrefix(&source, "svn+")) {
+    vcs_source.vcs = Vcs::SVN;
+  } else if (source.substr(0, 6) == "svn://") {
+    vcs_source.vcs = Vcs::SVN;
+  } else {
+    return std::nullopt;
+  }
+
+  std::string_view fragment;
+  if (auto n = source.find('#'); n != std::string_view::npos) {
+    fragment = source.substr(n + 1);
+    source = source.substr(0, n);
+  }
+
+  // makepkg allows requesting signature verification of git sources with a
+  // trailing ?signed on either the URL or the fragment.
+  for (auto* part : {&source, &fragment}) {
+    if (auto n = part->find("?signed"); n != std::string_view::npos) {
+      *part = part->substr(0, n);
+    }
+  }
+
+  // The URL comes from a .SRCINFO that anyone can upload, and is handed to a
+  // VCS client on its command line. Never let it be read as an option.
+  if (source.empty() || source[0] == '-') {
+    return std::nullopt;
+  }
+
+  vcs_source.url = source;
+
+  if (!fragment.empty()) {
+    const auto equals = fragment.find('=');
+    const auto key = fragment.substr(0, equals);
+    const auto value = equals == std::string_view::npos
+                           ? std::string_view()
+                           : fragment.substr(equals + 1);
+
+    if (key != "branch") {
+      // Pinned to a commit, revision, or tag.
+      return std::nullopt;
+    }
+
+    if (vcs_source.vcs == Vcs::GIT) {
+      vcs_source.ref.assign("refs/heads/").append(value);
+    } else {
+      vcs_source.ref = value;
+    }
+  }
+
+  return vcs_source;
+}
+
+bool IsHex(std::string_view s) {
+  return std::all_of(s.begin(), s.end(),
+                     [](char c) { return std::isxdigit(c) != 0; });
+}
+
+bool IsDigits(std::string_view s) {
+  return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) {
+    return std::isdigit(c) != 0;
+  });
+}
+
+// Returns the pkgver component of a full version string, i.e. without any
+// epoch or pkgrel.
+std::string_view PkgverOf(std::string_view version) {
+  if (auto n = version.find(':'); n != std::string_view::npos) {
+    version.remove_prefix(n + 1);
+  }
+
+  return version.substr(0, version.rfind('-'));
+}
+
+std::optional<bool> HashHasMoved(std::string_view pkgver,
+                                 std::string_view head) {
+  // Abbreviated hashes are conventionally at least 7 characters, and show up
+  // as their own component of the pkgver, possibly prefixed with 'g' as in the
+  // output of git-describe.
+  constexpr size_t kMinHashLength = 7;
+
+  bool found_hash = false;
+  for (auto token : Split(pkgver, ".-_+")) {
+    const bool describe_style = token.size() > kMinHashLength &&
+                                token[0] == 'g' && IsHex(token.substr(1));
+    if (describe_style) {
+      token.remove_prefix(1);
+    }
+
+    if (token.size() < kMinHashLength || !IsHex(token)) {
+      continue;
+    }
+
+    // An all-numeric component is far more likely to be a date or a counter
+    // than a hash.
+    if (!describe_style && IsDigits(token)) {
+      continue;
+    }
+
+    found_hash = true;
+
+    if (token.size() <= head.size() &&
+        std::equal(token.begin(), token.end(), head.begin(),
+                   [](char a, char b) {
+                     return std::tolower(a) == std::tolower(b);
+                   })) {
+      return false;
+    }
+  }
+
+  if (!found_hash) {
+    return std::nullopt;
+  }
+
+  return true;
+}
+
+std::optional<bool> RevisionHasMoved(std::string_view pkgver,
+                                     std::string_view head) {
+  if (!IsDigits(head)) {
+    return std::nullopt;
+  }
+
+  std::optional<unsigned long long> local;
+  if (IsDigits(pkgver)) {
+    local = std::stoull(std::string(pkgver));
+  } else {
+    for (auto token : Split(pkgver, ".-_+")) {
+      if (ConsumePrefix(&token, "r") && IsDigits(token)) {
+        local = std::stoull(std::string(token));
+        break;
+      }
+    }
+  }
+
+  if (!local) {
+    return std::nullopt;
+  }
+
+  return std::stoull(std::string(head)) > *local;
+}
+
+}  // namespace
+
+bool IsVcsPackage(std::string_view pkgname) {
+  return EndsWith(pkgname, "-git") || EndsWith(pkgname, "-hg") ||
+         EndsWith(pkgname, "-svn");
+}
+
+std::vector<VcsSource> ParseVcsSources(std::string_view srcinfo) {
+  std::vector<VcsSource> sources;
+
+  for (auto line : Split(srcinfo, "\n")) {
+    const auto equals = line.find('=');
+    if (equals == std::string_view::npos) {
+      continue;
+    }
+
+    // Architecture specific sources are written as source_x86_64.
+    const auto key = Trim(line.substr(0, equals));
+    if (key != "source" && key.substr(0, 7) != "source_") {
+      continue;
+    }
+
+    if (auto source = ParseVcsSource(Trim(line.substr(equals + 1)))) {
+      sources.push_back(std::move(*source));
+    }
+  }
+
+  return sources;
+}
+
+std::optional<bool> UpstreamHasMoved(Vcs vcs, std::string_view local_version,
+                                     std::string_view head) {
+  if (head.empty()) {
+    return std::nullopt;
+  }
+
+  const auto pkgver = PkgverOf(local_version);
+
+  switch (vcs) {
+    case Vcs::GIT:
+    case Vcs::HG:
+      return HashHasMoved(pkgver, head);
+    case Vcs::SVN:
+      return RevisionHasMoved(pkgver, head);
+  }
+
+  return std::nullopt;
+}
+
+// static
+std::string VcsHeadCache::KeyFor(const VcsSource& source) {
+  const char* vcs = "";
+  switch (source.vcs) {
+    case Vcs::GIT:
+      vcs = "git";
+      break;
+    case Vcs::HG:
+      vcs = "hg";
+      break;
+    case Vcs::SVN:
+      vcs = "svn";
+      break;
+  }
+
+  std::string key(vcs);
+  key.append("\t").append(source.url).append("\t").append(source.ref);
+  return key;
+}
+
+std::optional<std::string> VcsHeadCache::Lookup(const VcsSource& source,
+                                                Clock::time_point now) const {
+  const auto iter = entries_.find(KeyFor(source));
+  if (iter == entries_.end() || now - iter->second.updated > ttl_) {
+    return std::nullopt;
+  }
+
+  return iter->second.head;
+}
+
+void VcsHeadCache::Store(const VcsSource& source, std::string head,
+                         Clock::time_point now) {
+  entries_[KeyFor(source)] = Entry{std::move(head), now};
+}
+
+void VcsHeadCache::Load(const fs::path& path) {
+  std::ifstream file(path);
+
+  // Each line is: updated <TAB> vcs <TAB> url <TAB> ref <TAB> head
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto fields = Split(line, "\t");
+    if (fields.size() != 5 || !IsDigits(fields[0]) || fields[4].empty()) {
+      continue;
+    }
+
+    const auto updated = Clock::time_point(
+        std::chrono::seconds(std::stoll(std::string(fields[0]))));
+
+    std::string key(line.substr(fields[0].size() + 1,
+                                line.size() - fields[0].size() -
+                                    fields[4].size() - 2));
+    entries_[std::move(key)] = Entry{std::string(fields[4]), updated};
+  }
+}
+
+bool VcsHeadCache::Save(const fs::path& path, Clock::time_point now) const {
+  std::error_code ec;
+  fs::create_directories(path.parent_path(), ec);
+  if (ec) {
+    return false;
+  }
+
+  std::ostringstream contents;
+  for (const auto& [key, entry] : entries_) {
+    if (now - entry.updated > ttl_) {
+      continue;
+    }
+
+    const auto updated = std::chrono::duration_cast<std::chrono::seconds>(
+        entry.updated.time_since_epoch());
+    contents << updated.count() << '\t' << key << '\t' << entry.head << '\n';
+  }
+  const auto bytes = std::move(contents).str();
+
+  // Each writer gets a file of its own, so that concurrent runs can't write
+  // over each other before the rename.
+  std::string tmp = path.string() + ".XXXXXX";
+  const int fd = mkstemp(tmp.data());
+  if (fd < 0) {
+    return false;
+  }
+
+  for (size_t written = 0; written < bytes.size();) {
+    const ssize_t n =
+        write(fd, bytes.data() + written, bytes.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      unlink(tmp.c_str());
+      return false;
+    }
+    written += n;
+  }
+
+  if (close(fd) < 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace auracle
@@ -0,0 +1,78 @@
+#ifndef AURACLE_VCS_HH_
+#define AURACLE_VCS_HH_
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "aur/request.hh"
+
+namespace auracle {
+
+// An upstream repository which tracks a moving head, as named in the source
+// array of a package.
+struct VcsSource {
+  aur::VcsHeadRequest::Vcs vcs;
+  std::string url;
+  std::string ref;
+};
+
+// Returns true if the package name carries one of the conventional suffixes
+// for packages built from VCS sources, e.g. foo-git.
+bool IsVcsPackage(std::string_view pkgname);
+
+// Extracts the VCS sources from the contents of a .SRCINFO file. Sources which
+// are pinned to a fixed commit, revision or tag are omitted since they can't
+// move.
+std::vector<VcsSource> ParseVcsSources(std::string_view srcinfo);
+
+// Determines whether the upstream head has moved past the version of a locally
+// installed package. Returns std::nullopt if the version doesn't encode
+// anything comparable to the head, e.g. a commit hash for git.
+std::optional<bool> UpstreamHasMoved(aur::VcsHeadRequest::Vcs vcs,
+                                     std::string_view local_version,
+                                     std::string_view head);
+
+// A persistent record of recently observed upstream heads.
+class VcsHeadCache {
+ public:
+  using Clock = std::chrono::system_clock;
+
+  explicit VcsHeadCache(std::chrono::seconds ttl) : ttl_(ttl) {}
+  ~VcsHeadCache() = default;
+
+  VcsHeadCache(const VcsHeadCache&) = delete;
+  VcsHeadCache& operator=(const VcsHeadCache&) = delete;
+
+  VcsHeadCache(VcsHeadCache&&) = default;
+  VcsHeadCache& operator=(VcsHeadCache&&) = default;
+
+  // Returns the cached head for the source, unless it's older than the TTL.
+  std::optional<std::string> Lookup(const VcsSource& source,
+                                    Clock::time_point now) const;
+  void Store(const VcsSource& source, std::string head, Clock::time_point now);
+
+  // Loading a missing or malformed file isn't an error, it simply leaves the
+  // cache empty. Expired entries are dropped on save.
+  void Load(const std::filesystem::path& path);
+  bool Save(const std::filesystem::path& path, Clock::time_point now) const;
+
+ private:
+  struct Entry {
+    std::string head;
+    Clock::time_point updated;
+  };
+
+  static std::string KeyFor(const VcsSource& source);
+
+  std::chrono::seconds ttl_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // namespace auracle
+
+#endif  // AURACLE_VCS_HH_
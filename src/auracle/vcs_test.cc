@@ -0,0 +1,172 @@
+#include "vcs.hh"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using Vcs = aur::VcsHeadRequest::Vcs;
+
+TEST(VcsTest, DetectsVcsPackages) {
+  EXPECT_TRUE(auracle::IsVcsPackage("auracle-git"));
+  EXPECT_TRUE(auracle::IsVcsPackage("mercurial-hg"));
+  EXPECT_TRUE(auracle::IsVcsPackage("subversion-svn"));
+
+  EXPECT_FALSE(auracle::IsVcsPackage("auracle"));
+  EXPECT_FALSE(auracle::IsVcsPackage("git"));
+  EXPECT_FALSE(auracle::IsVcsPackage("git-lfs"));
+}
+
+TEST(VcsTest, ParsesVcsSources) {
+  const auto sources = auracle::ParseVcsSources(R"(pkgbase = auracle-git
+	pkgdesc = A flexible client for the AUR
+	pkgver = r74.82e863f
+	source = git+https://github.com/falconindy/auracle.git
+	source = foo::git+https://example.com/foo.git#branch=devel
+	source = bar::hg+https://example.com/bar#branch=stable
+	source_x86_64 = svn+https://example.com/svn/trunk
+	source = git://example.com/signed.git?signed
+	source = git+https://example.com/pinned.git#tag=v1.0?signed
+	source = git+https://example.com/pinned.git#commit=82e863f
+	source = https://example.com/release.tar.gz
+	sha256sums = SKIP
+
+pkgname = auracle-git
+)");
+
+  ASSERT_EQ(sources.size(), 5);
+
+  EXPECT_EQ(sources[0].vcs, Vcs::GIT);
+  EXPECT_EQ(sources[0].url, "https://github.com/falconindy/auracle.git");
+  EXPECT_EQ(sources[0].ref, "");
+
+  EXPECT_EQ(sources[1].vcs, Vcs::GIT);
+  EXPECT_EQ(sources[1].url, "https://example.com/foo.git");
+  EXPECT_EQ(sources[1].ref, "refs/heads/devel");
+
+  EXPECT_EQ(sources[2].vcs, Vcs::HG);
+  EXPECT_EQ(sources[2].url, "https://example.com/bar");
+  EXPECT_EQ(sources[2].ref, "stable");
+
+  EXPECT_EQ(sources[3].vcs, Vcs::SVN);
+  EXPECT_EQ(sources[3].url, "https://example.com/svn/trunk");
+
+  EXPECT_EQ(sources[4].vcs, Vcs::GIT);
+  EXPECT_EQ(sources[4].url, "git://example.com/signed.git");
+}
+
+TEST(VcsTest, RejectsSourcesThatLookLikeOptions) {
+  const auto sources = auracle::ParseVcsSources(R"(pkgbase = evil-git
+	source = git+--upload-pack=touch /tmp/pwned
+	source = foo::git+-u=touch /tmp/pwned
+	source = hg+--config=hooks.pre-identify=touch /tmp/pwned
+	source = svn+--config-option=config:tunnels:ssh=touch
+	source = git+
+	source = git+https://example.com/ok.git
+)");
+
+  ASSERT_EQ(sources.size(), 1);
+  EXPECT_EQ(sources[0].url, "https://example.com/ok.git");
+}
+
+TEST(VcsTest, ComparesGitHashes) {
+  constexpr char kHead[] = "82e863f0c8a7f3ba1c2e5d7f6b1e0a9d8c7b6a5f";
+
+  // Revision count and abbreviated hash.
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::GIT, "r74.82e863f-1", kHead), false);
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::GIT, "r20.fb982ca-1", kHead), true);
+
+  // git-describe style, with an epoch.
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::GIT, "1:21.38.g82e863f-2", kHead),
+            false);
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::GIT, "18.5.gf31f10b-1", kHead),
+            true);
+
+  // Nothing resembling a hash.
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::GIT, "20200101.1234-1", kHead),
+            std::nullopt);
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::GIT, "r74.82e863f-1", ""),
+            std::nullopt);
+}
+
+TEST(VcsTest, ComparesSvnRevisions) {
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::SVN, "r1234-1", "1234"), false);
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::SVN, "1.0.r1234-1", "1240"), true);
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::SVN, "1234-1", "1240"), true);
+  EXPECT_EQ(auracle::UpstreamHasMoved(Vcs::SVN, "1.0-1", "1240"),
+            std::nullopt);
+}
+
+TEST(VcsTest, CacheExpiresEntries) {
+  using namespace std::chrono_literals;
+
+  const auracle::VcsSource source{Vcs::GIT, "https://example.com/foo.git",
+                                  ""};
+  const auracle::VcsHeadCache::Clock::time_point now(1000000s);
+
+  auracle::VcsHeadCache cache(60s);
+  EXPECT_EQ(cache.Lookup(source, now), std::nullopt);
+
+  cache.Store(source, "82e863f", now);
+  EXPECT_EQ(cache.Lookup(source, now + 30s), "82e863f");
+  EXPECT_EQ(cache.Lookup(source, now + 90s), std::nullopt);
+
+  // Same URL, different branch.
+  EXPECT_EQ(cache.Lookup({Vcs::GIT, source.url, "refs/heads/devel"}, now),
+            std::nullopt);
+}
+
+TEST(VcsTest, CacheRoundTripsThroughFile) {
+  using namespace std::chrono_literals;
+
+  char tmpdir[] = "/tmp/vcs_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = std::filesystem::path(tmpdir) / "cache" / "vcs-heads";
+
+  const auracle::VcsSource fresh{Vcs::GIT, "https://example.com/foo.git",
+                                 "refs/heads/devel"};
+  const auracle::VcsSource stale{Vcs::HG, "https://example.com/bar", ""};
+  const auracle::VcsHeadCache::Clock::time_point now(1000000s);
+
+  {
+    auracle::VcsHeadCache cache(60s);
+    cache.Store(fresh, "82e863f", now);
+    cache.Store(stale, "0123456789ab", now - 120s);
+    ASSERT_TRUE(cache.Save(path, now));
+  }
+
+  {
+    auracle::VcsHeadCache cache(60s);
+    cache.Load(path);
+    EXPECT_EQ(cache.Lookup(fresh, now), "82e863f");
+    EXPECT_EQ(cache.Lookup(stale, now - 120s), std::nullopt);
+  }
+
+  std::filesystem::remove_all(tmpdir);
+}
+
+TEST(VcsTest, CacheSavesLeaveNoTemporaryFiles) {
+  using namespace std::chrono_literals;
+
+  char tmpdir[] = "/tmp/vcs_test.XXXXXX";
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  const auto path = std::filesystem::path(tmpdir) / "vcs-heads";
+  const auracle::VcsHeadCache::Clock::time_point now(1000000s);
+
+  auracle::VcsHeadCache cache(60s);
+  cache.Store({Vcs::GIT, "https://example.com/foo.git", ""}, "82e863f", now);
+  ASSERT_TRUE(cache.Save(path, now));
+  ASSERT_TRUE(cache.Save(path, now));
+
+  std::vector<std::string> files;
+  for (const auto& entry : std::filesystem::directory_iterator(tmpdir)) {
+    files.push_back(entry.path().filename());
+  }
+  EXPECT_THAT(files, testing::ElementsAre("vcs-heads"));
+
+  std::filesystem::remove_all(tmpdir);
+}
@@ -0,0 +1,272 @@
+#include "version.hh"
+
+namespace auracle {
+
+namespace {
+
+// pacman classifies characters with the C locale's ctype functions, so only
+// ASCII letters and digits are ever part of a segment.
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool IsAlnum(char c) { return IsDigit(c) || IsAlpha(c); }
+
+// A maximal run of digits or letters, and the number of separator characters
+// which precede it.
+struct Token {
+  std::string_view text;
+  size_t separators = 0;
+  bool numeric = false;
+};
+
+// Yields the tokens of a version string one at a time. Once the tokens are
+// exhausted, Next() returns false and reports any trailing separators.
+class Tokenizer {
+ public:
+  explicit Tokenizer(std::string_view version) : version_(version) {}
+
+  bool Next(Token* token) {
+    const size_t start = pos_;
+    while (pos_ < version_.size() && !IsAlnum(version_[pos_])) {
+      ++pos_;
+    }
+    token->separators = pos_ - start;
+    if (pos_ == version_.size()) {
+      return false;
+    }
+
+    const auto begin = pos_;
+    token->numeric = IsDigit(version_[pos_]);
+    const auto same_class = token->numeric ? &IsDigit : &IsAlpha;
+    while (pos_ < version_.size() && same_class(version_[pos_])) {
+      ++pos_;
+    }
+    token->text = version_.substr(begin, pos_ - begin);
+
+    if (token->numeric) {
+      const auto nonzero = token->text.find_first_not_of('0');
+      token->text.remove_prefix(
+          nonzero == token->text.npos ? token->text.size() : nonzero);
+    }
+
+    return true;
+  }
+
+ private:
+  std::string_view version_;
+  size_t pos_ = 0;
+};
+
+// The character that rpmvercmp finds at some position in a version.
+enum class CharClass : short { END, SEPARATOR, DIGIT, ALPHA };
+
+CharClass ClassOf(const Token& token, bool found) {
+  if (!found) {
+    return CharClass::END;
+  }
+  return token.numeric ? CharClass::DIGIT : CharClass::ALPHA;
+}
+
+// Once either version runs out of segments, the remainder decides: a
+// remaining alpha segment never beats the end of the other version, but
+// anything else does.
+int Showdown(CharClass a, CharClass b) {
+  if (a == CharClass::END && b == CharClass::END) {
+    return 0;
+  }
+
+  if ((a == CharClass::END && b != CharClass::ALPHA) ||
+      a == CharClass::ALPHA) {
+    return -1;
+  }
+
+  return 1;
+}
+
+// A port of rpmvercmp from libalpm, over pre-split tokens.
+template <typename Cursor>
+int CompareTokens(Cursor a, Cursor b) {
+  for (;;) {
+    Token ta, tb;
+    const bool found_a = a.Next(&ta);
+    const bool found_b = b.Next(&tb);
+
+    if (!found_a || !found_b) {
+      // rpmvercmp gives up either before skipping separators, if one version
+      // has nothing left at all, or after skipping them.
+      const bool a_done = !found_a && ta.separators == 0;
+      const bool b_done = !found_b && tb.separators == 0;
+      if (a_done || b_done) {
+        return Showdown(
+            ta.separators > 0 ? CharClass::SEPARATOR : ClassOf(ta, found_a),
+            tb.separators > 0 ? CharClass::SEPARATOR : ClassOf(tb, found_b));
+      }
+
+      return Showdown(ClassOf(ta, found_a), ClassOf(tb, found_b));
+    }
+
+    if (ta.separators != tb.separators) {
+      return ta.separators < tb.separators ? -1 : 1;
+    }
+
+    // Numeric segments are always newer than alpha segments.
+    if (ta.numeric != tb.numeric) {
+      return ta.numeric ? 1 : -1;
+    }
+
+    // Longer numbers are bigger numbers. Otherwise, numbers compare like
+    // strings of the same length.
+    if (ta.numeric && ta.text.size() != tb.text.size()) {
+      return ta.text.size() < tb.text.size() ? -1 : 1;
+    }
+
+    if (const int rc = ta.text.compare(tb.text); rc != 0) {
+      return rc < 0 ? -1 : 1;
+    }
+  }
+}
+
+struct Evr {
+  std::string_view epoch;
+  std::string_view pkgver;
+  std::string_view pkgrel;
+  bool has_pkgrel = false;
+};
+
+// Splits the same way as libalpm's parseEVR: the epoch is any leading digits
+// followed by a colon and defaults to 0, and the pkgrel follows the last dash.
+Evr SplitEvr(std::string_view version) {
+  Evr evr;
+
+  size_t digits = 0;
+  while (digits < version.size() && IsDigit(version[digits])) {
+    ++digits;
+  }
+
+  evr.epoch = "0";
+  evr.pkgver = version;
+  if (digits < version.size() && version[digits] == ':') {
+    if (digits > 0) {
+      evr.epoch = version.substr(0, digits);
+    }
+    evr.pkgver = version.substr(digits + 1);
+  }
+
+  if (const auto dash = evr.pkgver.rfind('-'); dash != evr.pkgver.npos) {
+    evr.pkgrel = evr.pkgver.substr(dash + 1);
+    evr.pkgver = evr.pkgver.substr(0, dash);
+    evr.has_pkgrel = true;
+  }
+
+  return evr;
+}
+
+}  // namespace
+
+class Version::Cursor {
+ public:
+  Cursor(const Version& version, const Part& part)
+      : version_(version), part_(part), next_(part.begin) {}
+
+  bool Next(Token* token) {
+    if (next_ == part_.end) {
+      token->separators = part_.trailing;
+      return false;
+    }
+
+    const auto& segment = version_.segments_[next_++];
+    token->text =
+        std::string_view(version_.text_).substr(segment.offset, segment.size);
+    token->separators = segment.separators;
+    token->numeric = segment.numeric;
+    return true;
+  }
+
+ private:
+  const Version& version_;
+  const Part& part_;
+  uint32_t next_;
+};
+
+Version::Version(std::string_view version) : text_(version) {
+  const auto evr = SplitEvr(text_);
+
+  AppendPart(evr.epoch, &epoch_);
+  AppendPart(evr.pkgver, &pkgver_);
+  if (evr.has_pkgrel) {
+    AppendPart(evr.pkgrel, &pkgrel_);
+  }
+}
+
+void Version::AppendPart(std::string_view part, Part* out) {
+  out->begin = segments_.size();
+  out->present = true;
+
+  Tokenizer tokenizer(part);
+  Token token;
+  while (tokenizer.Next(&token)) {
+    // The default epoch doesn't point into |text_|, but it's also empty once
+    // its zero is stripped.
+    const auto offset =
+        token.text.empty() ? 0 : token.text.data() - text_.data();
+    segments_.push_back({static_cast<uint32_t>(offset),
+                         static_cast<uint32_t>(token.text.size()),
+                         static_cast<uint32_t>(token.separators),
+                         token.numeric});
+  }
+
+  out->end = segments_.size();
+  out->trailing = token.separators;
+}
+
+// static
+int Version::Compare(const Version& a, const Version& b) {
+  if (a.text_ == b.text_) {
+    return 0;
+  }
+
+  int ret = CompareTokens(Cursor(a, a.epoch_), Cursor(b, b.epoch_));
+  if (ret == 0) {
+    ret = CompareTokens(Cursor(a, a.pkgver_), Cursor(b, b.pkgver_));
+    if (ret == 0 && a.pkgrel_.present && b.pkgrel_.present) {
+      ret = CompareTokens(Cursor(a, a.pkgrel_), Cursor(b, b.pkgrel_));
+    }
+  }
+
+  return ret;
+}
+
+// static
+int Version::CompareForSort(const Version& a, const Version& b) {
+  const int ret = Compare(a, b);
+  if (ret == 0 && a.pkgrel_.present != b.pkgrel_.present) {
+    return a.pkgrel_.present ? 1 : -1;
+  }
+
+  return ret;
+}
+
+// static
+int Version::Compare(std::string_view a, std::string_view b) {
+  if (a == b) {
+    return 0;
+  }
+
+  const auto evr_a = SplitEvr(a);
+  const auto evr_b = SplitEvr(b);
+
+  int ret = CompareTokens(Tokenizer(evr_a.epoch), Tokenizer(evr_b.epoch));
+  if (ret == 0) {
+    ret = CompareTokens(Tokenizer(evr_a.pkgver), Tokenizer(evr_b.pkgver));
+    if (ret == 0 && evr_a.has_pkgrel && evr_b.has_pkgrel) {
+      ret = CompareTokens(Tokenizer(evr_a.pkgrel), Tokenizer(evr_b.pkgrel));
+    }
+  }
+
+  return ret;
+}
+
+}  // namespace auracle
@@ -0,0 +1,76 @@
+#ifndef AURACLE_VERSION_HH_
+#define AURACLE_VERSION_HH_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace auracle {
+
+// A package version of the form [epoch:]pkgver[-pkgrel], split up front into
+// the alphanumeric segments that pacman compares. Comparing two Versions
+// gives the same result as alpm_pkg_vercmp, but never reparses or allocates,
+// so it's worth keeping these around for versions which are compared often.
+class Version {
+ public:
+  explicit Version(std::string_view version);
+
+  // Returns a negative number, zero, or a positive number if |a| is
+  // respectively older than, the same as, or newer than |b|.
+  static int Compare(const Version& a, const Version& b);
+
+  // As above, for versions which are only compared once. Doesn't allocate.
+  static int Compare(std::string_view a, std::string_view b);
+
+  // As Compare(), except that a version without a pkgrel is older than the
+  // same version with one. Compare() treats it as equal to every pkgrel,
+  // which isn't the strict weak ordering that sorting requires.
+  static int CompareForSort(const Version& a, const Version& b);
+
+  const std::string& str() const { return text_; }
+
+  bool operator<(const Version& other) const {
+    return Compare(*this, other) < 0;
+  }
+  bool operator>(const Version& other) const {
+    return Compare(*this, other) > 0;
+  }
+  bool operator==(const Version& other) const {
+    return Compare(*this, other) == 0;
+  }
+  bool operator!=(const Version& other) const {
+    return Compare(*this, other) != 0;
+  }
+
+ private:
+  struct Segment {
+    // Leading zeros are already stripped from numeric segments.
+    uint32_t offset;
+    uint32_t size;
+    uint32_t separators;
+    bool numeric;
+  };
+
+  // A run of |segments_|, followed by |trailing| separator characters.
+  struct Part {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    uint32_t trailing = 0;
+    bool present = false;
+  };
+
+  class Cursor;
+
+  void AppendPart(std::string_view part, Part* out);
+
+  std::string text_;
+  std::vector<Segment> segments_;
+  Part epoch_;
+  Part pkgver_;
+  Part pkgrel_;
+};
+
+}  // namespace auracle
+
+#endif  // AURACLE_VERSION_HH_
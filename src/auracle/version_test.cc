@@ -0,0 +1,137 @@
+#include "version.hh"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+using auracle::Version;
+
+namespace {
+
+struct VercmpCase {
+  const char* a;
+  const char* b;
+  int expected;
+};
+
+// Adapted from pacman's own vercmp test suite.
+constexpr VercmpCase kCases[] = {
+    // Equality.
+    {"1.5.0", "1.5.0", 0},
+    {"1.5.1", "1.5.0", 1},
+
+    // Mixed length.
+    {"1.5.1", "1.5", 1},
+
+    // With pkgrel, simple.
+    {"1.5.0-1", "1.5.0-1", 0},
+    {"1.5.0-1", "1.5.0-2", -1},
+    {"1.5.0-1", "1.5.1-1", -1},
+    {"1.5.0-2", "1.5.1-1", -1},
+
+    // With pkgrel, mixed lengths.
+    {"1.5-1", "1.5.1-1", -1},
+    {"1.5-2", "1.5.1-1", -1},
+    {"1.5-2", "1.5.1-2", -1},
+
+    // Mixed pkgrel inclusion.
+    {"1.5", "1.5-1", 0},
+    {"1.5-1", "1.5", 0},
+    {"1.1-1", "1.1", 0},
+    {"1.0-1", "1.1", -1},
+    {"1.1-1", "1.0", 1},
+
+    // Alphanumeric versions.
+    {"1.5b-1", "1.5-1", -1},
+    {"1.5b", "1.5", -1},
+    {"1.5b-1", "1.5", -1},
+    {"1.5b", "1.5.1", -1},
+
+    // From the manpage.
+    {"1.0a", "1.0alpha", -1},
+    {"1.0alpha", "1.0b", -1},
+    {"1.0b", "1.0beta", -1},
+    {"1.0beta", "1.0rc", -1},
+    {"1.0rc", "1.0", -1},
+
+    // Going crazy? Alpha-dot-zero.
+    {"1.5.a", "1.5", 1},
+    {"1.5.b", "1.5.a", 1},
+    {"1.5.1", "1.5.b", 1},
+
+    // Alpha dots and dashes.
+    {"1.5.b-1", "1.5.b", 0},
+    {"1.5-1", "1.5.b", -1},
+
+    // Same/similar content, differing separators.
+    {"2.0", "2_0", 0},
+    {"2.0_a", "2_0.a", 0},
+    {"2.0a", "2.0.a", -1},
+    {"2___a", "2_a", 1},
+
+    // Epoch included version comparisons.
+    {"0:1.0", "0:1.0", 0},
+    {"0:1.0", "0:1.1", -1},
+    {"1:1.0", "0:1.0", 1},
+    {"1:1.0", "0:1.1", 1},
+    {"1:1.0", "2:1.1", -1},
+
+    // Epoch + sometimes present pkgrel.
+    {"1:1.0", "0:1.0-1", 1},
+    {"1:1.0-1", "0:1.1-1", 1},
+
+    // Epoch included on one version.
+    {"0:1.0", "1.0", 0},
+    {"0:1.0", "1.1", -1},
+    {"0:1.1", "1.0", 1},
+    {"1:1.0", "1.0", 1},
+    {"1:1.0", "1.1", 1},
+    {"1:1.1", "1.1", 1},
+
+    // Leading zeros and long numbers.
+    {"1.007", "1.7", 0},
+    {"1.10", "1.9", 1},
+    {"20200101", "9", 1},
+};
+
+}  // namespace
+
+TEST(VersionTest, ComparesStrings) {
+  for (const auto& c : kCases) {
+    EXPECT_EQ(Version::Compare(c.a, c.b), c.expected)
+        << c.a << " vs " << c.b;
+    EXPECT_EQ(Version::Compare(c.b, c.a), -c.expected)
+        << c.b << " vs " << c.a;
+  }
+}
+
+TEST(VersionTest, ComparesParsedVersions) {
+  for (const auto& c : kCases) {
+    const Version a(c.a), b(c.b);
+    EXPECT_EQ(Version::Compare(a, b), c.expected) << c.a << " vs " << c.b;
+    EXPECT_EQ(Version::Compare(b, a), -c.expected) << c.b << " vs " << c.a;
+  }
+}
+
+TEST(VersionTest, SortsMissingPkgrelFirst) {
+  EXPECT_EQ(Version::Compare(Version("1.0"), Version("1.0-1")), 0);
+  EXPECT_EQ(Version::Compare(Version("1.0"), Version("1.0-2")), 0);
+
+  EXPECT_LT(Version::CompareForSort(Version("1.0"), Version("1.0-1")), 0);
+  EXPECT_GT(Version::CompareForSort(Version("1.0-1"), Version("1.0")), 0);
+  EXPECT_LT(Version::CompareForSort(Version("1.0-1"), Version("1.0-2")), 0);
+  EXPECT_EQ(Version::CompareForSort(Version("1.0"), Version("1.0")), 0);
+  EXPECT_GT(Version::CompareForSort(Version("1.1"), Version("1.0-2")), 0);
+}
+
+TEST(VersionTest, SurvivesCopies) {
+  std::string text = "1:2.3.4-5";
+  const Version original(text);
+  text.clear();
+
+  const Version copy = original;
+  EXPECT_EQ(copy.str(), "1:2.3.4-5");
+  EXPECT_EQ(copy, Version("1:2.3.4-5"));
+  EXPECT_TRUE(copy < Version("1:2.3.5-1"));
+  EXPECT_TRUE(copy > Version("2.3.4-5"));
+}
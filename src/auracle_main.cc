@@ -1,8 +1,12 @@
 #include <getopt.h>
 
+#include <chrono>
 #include <clocale>
+#include <fstream>
 #include <iostream>
+#include <optional>
 
+#include "aur/profiler.hh"
 #include "auracle/auracle.hh"
 #include "auracle/format.hh"
 #include "auracle/sort.hh"
@@ -12,12 +16,70 @@ namespace {
 
 constexpr std::string_view kAurBaseurl = "https://aur.archlinux.org";
 constexpr std::string_view kPacmanConf = "/etc/pacman.conf";
+constexpr auto kProfileInterval = std::chrono::milliseconds(1);
+
+std::string DefaultCacheDir() {
+  if (const char* xdg_cache_home = getenv("XDG_CACHE_HOME");
+      xdg_cache_home != nullptr && xdg_cache_home[0] != '\0') {
+    return std::string(xdg_cache_home) + "/auracle";
+  }
+
+  if (const char* home = getenv("HOME"); home != nullptr && home[0] != '\0') {
+    return std::string(home) + "/.cache/auracle";
+  }
+
+  return std::string();
+}
+
+// A sort key of "none" leaves results in the order that they arrive in.
+bool ParseSorter(std::string_view field, sort::OrderBy order_by,
+                 sort::Sorter* sorter) {
+  if (field == "none") {
+    *sorter = nullptr;
+    return true;
+  }
+
+  *sorter = sort::MakePackageSorter(field, order_by);
+  return *sorter != nullptr;
+}
+
+// Profiles everything from its construction until its destruction, after which
+// the samples are written to |path| as folded stacks.
+class ScopedProfile {
+ public:
+  explicit ScopedProfile(std::string path) : path_(std::move(path)) {
+    if (!path_.empty() && !aur::Profiler::Start(kProfileInterval)) {
+      std::cerr << "warning: failed to start profiler\n";
+      path_.clear();
+    }
+  }
+
+  ~ScopedProfile() {
+    if (path_.empty()) {
+      return;
+    }
+
+    std::ofstream file(path_, std::ofstream::trunc);
+    file << aur::Profiler::Stop();
+    if (!file.flush()) {
+      std::cerr << "error: failed to write profile to " << path_ << "\n";
+    }
+  }
+
+  ScopedProfile(const ScopedProfile&) = delete;
+  ScopedProfile& operator=(const ScopedProfile&) = delete;
+
+ private:
+  std::string path_;
+};
 
 struct Flags {
   bool ParseFromArgv(int* argc, char*** argv);
 
   std::string baseurl = std::string(kAurBaseurl);
+  std::string unix_socket;
   std::string pacman_config = std::string(kPacmanConf);
+  std::string profile;
   terminal::WantColor color = terminal::WantColor::AUTO;
 
   auracle::Auracle::CommandOptions command_options;
@@ -34,6 +96,7 @@ struct Flags {
       "\n"
       "  -q, --quiet              Output less, when possible\n"
       "  -r, --recurse            Recurse dependencies when cloning\n"
+      "      --devel              Check upstream of VCS packages for updates\n"
       "      --literal            Disallow regex in searches\n"
       "      --searchby=BY        Change search-by dimension\n"
       "      --color=WHEN         One of 'auto', 'never', or 'always'\n"
@@ -42,6 +105,11 @@ struct Flags {
       "      --show-file=FILE     File to dump with 'show' command\n"
       "  -C DIR, --chdir=DIR      Change directory to DIR before cloning\n"
       "  -F FMT, --format=FMT     Specify custom output for search and info\n"
+      "      --json               Output search and info results as JSON\n"
+      "      --filter=EXPR        Show only search and info results matching\n"
+      "                           EXPR\n"
+      "      --profile=FILE       Write a sampled profile of each phase to\n"
+      "                           FILE\n"
       "\n"
       "Commands:\n"
       "  buildorder               Show build order\n"
@@ -73,6 +141,11 @@ bool Flags::ParseFromArgv(int* argc, char*** argv) {
     ARG_RSORT,
     ARG_PACMAN_CONFIG,
     ARG_SHOW_FILE,
+    ARG_DEVEL,
+    ARG_JSON,
+    ARG_FILTER,
+    ARG_UNIX_SOCKET,
+    ARG_PROFILE,
   };
 
   static constexpr struct option opts[] = {
@@ -82,7 +155,11 @@ bool Flags::ParseFromArgv(int* argc, char*** argv) {
       { "recurse",         no_argument,       nullptr, 'r' },
       { "chdir",           required_argument, nullptr, 'C' },
       { "color",           required_argument, nullptr, ARG_COLOR },
+      { "devel",           no_argument,       nullptr, ARG_DEVEL },
+      { "filter",          required_argument, nullptr, ARG_FILTER },
+      { "json",            no_argument,       nullptr, ARG_JSON },
       { "literal",         no_argument,       nullptr, ARG_LITERAL },
+      { "profile",         required_argument, nullptr, ARG_PROFILE },
       { "rsort",           required_argument, nullptr, ARG_RSORT },
       { "searchby",        required_argument, nullptr, ARG_SEARCHBY },
       { "show-file",       required_argument, nullptr, ARG_SHOW_FILE },
@@ -94,6 +171,7 @@ bool Flags::ParseFromArgv(int* argc, char*** argv) {
       // usage.
       { "baseurl",         required_argument, nullptr, ARG_BASEURL },
       { "pacmanconfig",    required_argument, nullptr, ARG_PACMAN_CONFIG },
+      { "unix-socket",     required_argument, nullptr, ARG_UNIX_SOCKET },
       {},
       // clang-format on
   };
@@ -120,17 +198,36 @@ bool Flags::ParseFromArgv(int* argc, char*** argv) {
         break;
       case 'F': {
         std::string error;
-        if (!format::FormatIsValid(optarg, &error)) {
+        auto compiled = format::Template::Compile(sv_optarg, &error);
+        if (!compiled) {
           std::cerr << "error: invalid arg to --format (" << error
                     << "): " << sv_optarg << "\n";
           return false;
         }
-        command_options.format = optarg;
+        command_options.format = std::move(*compiled);
+        break;
+      }
+      case ARG_FILTER: {
+        std::string error;
+        auto filter = auracle::Filter::Parse(
+            sv_optarg, auracle::Filter::Clock::now(), &error);
+        if (!filter) {
+          std::cerr << "error: invalid arg to --filter (" << error
+                    << "): " << sv_optarg << "\n";
+          return false;
+        }
+        command_options.filter = std::move(*filter);
         break;
       }
       case ARG_LITERAL:
         command_options.allow_regex = false;
         break;
+      case ARG_JSON:
+        command_options.json = true;
+        break;
+      case ARG_DEVEL:
+        command_options.devel = true;
+        break;
       case ARG_SEARCHBY:
         using SearchBy = aur::SearchRequest::SearchBy;
 
@@ -155,17 +252,15 @@ bool Flags::ParseFromArgv(int* argc, char*** argv) {
         }
         break;
       case ARG_SORT:
-        command_options.sorter =
-            sort::MakePackageSorter(sv_optarg, sort::OrderBy::ORDER_ASC);
-        if (command_options.sorter == nullptr) {
+        if (!ParseSorter(sv_optarg, sort::OrderBy::ORDER_ASC,
+                         &command_options.sorter)) {
           std::cerr << "error: invalid arg to --sort: " << sv_optarg << "\n";
           return false;
         }
         break;
       case ARG_RSORT:
-        command_options.sorter =
-            sort::MakePackageSorter(sv_optarg, sort::OrderBy::ORDER_DESC);
-        if (command_options.sorter == nullptr) {
+        if (!ParseSorter(sv_optarg, sort::OrderBy::ORDER_DESC,
+                         &command_options.sorter)) {
           std::cerr << "error: invalid arg to --rsort: " << sv_optarg << "\n";
           return false;
         }
@@ -176,6 +271,12 @@ bool Flags::ParseFromArgv(int* argc, char*** argv) {
       case ARG_PACMAN_CONFIG:
         pacman_config = optarg;
         break;
+      case ARG_UNIX_SOCKET:
+        unix_socket = optarg;
+        break;
+      case ARG_PROFILE:
+        profile = optarg;
+        break;
       case ARG_VERSION:
         version();
         break;
@@ -206,18 +307,15 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  // Declared first so that it's destroyed last, and sees all of the teardown.
+  ScopedProfile profile(flags.profile);
+  std::optional<aur::Profiler::Scope> config(std::in_place,
+                                             aur::Profiler::Phase::CONFIG);
+
   std::setlocale(LC_ALL, "");
   terminal::Init(flags.color);
 
-  const auto pacman = auracle::Pacman::NewFromConfig(flags.pacman_config);
-  if (pacman == nullptr) {
-    std::cerr << "error: failed to parse " << flags.pacman_config << "\n";
-    return 1;
-  }
-
-  auracle::Auracle auracle(auracle::Auracle::Options()
-                               .set_aur_baseurl(flags.baseurl)
-                               .set_pacman(pacman.get()));
+  const auto cache_dir = DefaultCacheDir();
 
   const std::string_view action(argv[1]);
   const std::vector<std::string> args(argv + 2, argv + argc);
@@ -248,6 +346,26 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  auracle::Auracle auracle(auracle::Auracle::Options()
+                               .set_aur_baseurl(flags.baseurl)
+                               .set_unix_socket(flags.unix_socket)
+                               .set_cache_dir(cache_dir));
+
+  // Every command talks to the AUR, so start connecting to it before the
+  // command does its local work, like reading names from stdin or loading the
+  // pacman index, ahead of its first request.
+  auracle.WarmUp();
+
+  const auto pacman =
+      auracle::Pacman::NewFromConfig(flags.pacman_config, cache_dir);
+  if (pacman == nullptr) {
+    std::cerr << "error: failed to parse " << flags.pacman_config << "\n";
+    return 1;
+  }
+  auracle.set_pacman(pacman.get());
+
+  config.reset();
+
   return (auracle.*iter->second)(args, flags.command_options) < 0 ? 1 : 0;
 }
 
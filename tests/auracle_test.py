@@ -95,32 +95,34 @@ class TestCase(unittest.TestCase):
         self.assertEqual(0, self.server.exitcode, 'Server did not exit cleanly')
 
 
-    def _WritePacmanConf(self):
+    def _WritePacmanConf(self, options=''):
         with open(os.path.join(self.tempdir, 'pacman.conf'), 'w') as f:
             f.write('''
             [options]
             DBPath = {}/fakepacman
+            {}
 
             [extra]
             Server = file:///dev/null
 
             [community]
             Server = file:///dev/null
-            '''.format(os.path.dirname(os.path.realpath(__file__))))
+            '''.format(os.path.dirname(os.path.realpath(__file__)), options))
 
 
-    def Auracle(self, args):
+    def Auracle(self, args, stdin=None, env=None):
         requests_file = tempfile.NamedTemporaryFile(
                 dir=self.tempdir, prefix='requests-', delete=False).name
 
-        env = {
+        env = dict(env or {}, **{
             'PATH': '{}/fakeaur:{}'.format(
                 os.path.dirname(os.path.realpath(__file__)), os.getenv('PATH')),
             'AURACLE_TEST_TMPDIR': self.tempdir,
+            'XDG_CACHE_HOME': os.path.join(self.tempdir, 'cache'),
             'AURACLE_DEBUG': 'requests:{}'.format(requests_file),
             'LC_TIME': 'C',
             'TZ': 'UTC',
-        }
+        })
 
         cmdline = [
             os.path.join(self.build_dir, 'auracle'),
@@ -131,7 +133,8 @@ class TestCase(unittest.TestCase):
         ] + args
 
         return AuracleRunResult(
-                subprocess.run(cmdline, env=env, capture_output=True),
+                subprocess.run(cmdline, env=env, capture_output=True,
+                               input=stdin),
                 requests_file)
 
 
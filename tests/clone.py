@@ -33,6 +33,13 @@ class TestClone(auracle_test.TestCase):
         ])
 
 
+    def testCloneNamesFromStdin(self):
+        r = self.Auracle(['clone', '-'], stdin=b'auracle-git pkgfile-git\n')
+        self.assertEqual(r.process.returncode, 0)
+        self.assertPkgbuildExists('auracle-git')
+        self.assertPkgbuildExists('pkgfile-git')
+
+
     def testCloneRecursive(self):
         r = self.Auracle(['clone', '-r', 'auracle-git'])
         self.assertEqual(r.process.returncode, 0)
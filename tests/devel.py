@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+
+import auracle_test
+import os
+import shutil
+
+
+UPSTREAM_HEAD = '82e863f94c0d7b7c3d2e1f1c4a5b6c7d8e9f0a1b'
+MOVED_HEAD = '0123456789abcdef0123456789abcdef01234567'
+
+
+class TestDevel(auracle_test.TestCase):
+
+    def setUp(self):
+        super().setUp()
+
+        # Install auracle-git at the same version as the AUR has, so that only
+        # a check of its upstream can find it outdated.
+        dbpath = os.path.join(self.tempdir, 'pacman')
+        shutil.copytree(
+            os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                         'fakepacman'), dbpath)
+
+        localdb = os.path.join(dbpath, 'local')
+        old = os.path.join(localdb, 'auracle-git-r20.fb982ca-1')
+        new = os.path.join(localdb, 'auracle-git-r74.82e863f-1')
+        os.rename(old, new)
+        with open(os.path.join(new, 'desc')) as f:
+            desc = f.read()
+        with open(os.path.join(new, 'desc'), 'w') as f:
+            f.write(desc.replace('r20.fb982ca-1', 'r74.82e863f-1'))
+
+        self._WritePacmanConf('DBPath = {}'.format(dbpath))
+
+
+    def testOutdatedIgnoresUpstreamWithoutDevel(self):
+        r = self.Auracle(['outdated', '--quiet'],
+                         env={'FAKEAUR_GIT_HEAD': MOVED_HEAD})
+        self.assertEqual(r.process.returncode, 0)
+        self.assertListEqual(r.process.stdout.decode().splitlines(),
+                             ['pkgfile-git'])
+
+
+    def testOutdatedFindsMovedUpstream(self):
+        r = self.Auracle(['outdated', '--quiet', '--devel'],
+                         env={'FAKEAUR_GIT_HEAD': MOVED_HEAD})
+        self.assertEqual(r.process.returncode, 0)
+        self.assertCountEqual(r.process.stdout.decode().splitlines(),
+                              ['auracle-git', 'pkgfile-git'])
+        self.assertIn('/cgit/aur.git/plain/.SRCINFO?h=auracle-git',
+                      r.request_uris)
+
+
+    def testOutdatedSkipsUnmovedUpstream(self):
+        r = self.Auracle(['outdated', '--quiet', '--devel'],
+                         env={'FAKEAUR_GIT_HEAD': UPSTREAM_HEAD})
+        self.assertEqual(r.process.returncode, 0)
+        self.assertListEqual(r.process.stdout.decode().splitlines(),
+                             ['pkgfile-git'])
+
+
+    def testOutdatedCachesUpstreamHeads(self):
+        r = self.Auracle(['outdated', '--quiet', '--devel'],
+                         env={'FAKEAUR_GIT_HEAD': MOVED_HEAD})
+        self.assertEqual(r.process.returncode, 0)
+
+        with open(os.path.join(self.tempdir, 'cache', 'auracle',
+                               'vcs-heads')) as f:
+            self.assertIn(MOVED_HEAD, f.read())
+
+        # The head seen a moment ago is still fresh, so upstream isn't asked
+        # again, and doesn't get the chance to say that it hasn't moved.
+        r = self.Auracle(['outdated', '--quiet', '--devel'],
+                         env={'FAKEAUR_GIT_HEAD': UPSTREAM_HEAD})
+        self.assertEqual(r.process.returncode, 0)
+        self.assertCountEqual(r.process.stdout.decode().splitlines(),
+                              ['auracle-git', 'pkgfile-git'])
+
+
+    def testUpdateDownloadsMovedUpstream(self):
+        r = self.Auracle(['update', '--quiet', '--devel', 'auracle-git'],
+                         env={'FAKEAUR_GIT_HEAD': MOVED_HEAD})
+        self.assertEqual(r.process.returncode, 0)
+        self.assertPkgbuildExists('auracle-git')
+
+
+if __name__ == '__main__':
+    auracle_test.main()
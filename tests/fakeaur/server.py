@@ -148,6 +148,12 @@ class FakeAurHandler(http.server.BaseHTTPRequestHandler):
         source_file = os.path.basename(url.path)
         if source_file == 'PKGBUILD':
             return self.respond(response=self.make_pkgbuild(pkgname))
+        elif source_file == '.SRCINFO':
+            try:
+                with open(os.path.join(DBROOT, 'srcinfo', pkgname)) as f:
+                    return self.respond(response=f.read().encode())
+            except FileNotFoundError:
+                return self.respond(status_code=404)
         else:
             return self.respond(status_code=404)
 
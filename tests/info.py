@@ -2,6 +2,7 @@
 
 import auracle_test
 import json
+import os
 
 
 class TestInfo(auracle_test.TestCase):
@@ -21,6 +22,46 @@ class TestInfo(auracle_test.TestCase):
         self.assertNotEqual(r.process.returncode, 0)
 
 
+    def testJsonOutput(self):
+        r = self.Auracle(['--json', 'info', 'auracle-git', 'pkgfile-git'])
+        self.assertEqual(r.process.returncode, 0)
+
+        packages = [json.loads(line)
+                    for line in r.process.stdout.decode().splitlines()]
+        self.assertListEqual(['auracle-git', 'pkgfile-git'],
+                             [p['Name'] for p in packages])
+        self.assertIn('Version', packages[0])
+
+
+    def testReadsNamesFromStdin(self):
+        r = self.Auracle(['info', '-'], stdin=b'auracle-git\npkgfile-git\n')
+        self.assertEqual(r.process.returncode, 0)
+        self.assertListEqual(r.request_uris, [
+            '/rpc?v=5&type=info&arg[]=auracle-git&arg[]=pkgfile-git',
+        ])
+
+
+    def testBatchesNamesFromStdin(self):
+        names = ['auracle-git'] + ['notfound{}'.format(i) for i in range(449)]
+        r = self.Auracle(['info', '-'], stdin='\n'.join(names).encode())
+        self.assertEqual(r.process.returncode, 0)
+
+        # Each batch is its own request, and every name is asked for once.
+        self.assertEqual(3, len(r.request_uris))
+        self.assertEqual(450, sum(uri.count('arg[]=')
+                                  for uri in r.request_uris))
+
+
+    def testOnlyIndexesTheLocalDb(self):
+        r = self.Auracle(['info', 'auracle-git'])
+        self.assertEqual(r.process.returncode, 0)
+
+        cache_dir = os.path.join(self.tempdir, 'cache', 'auracle')
+        self.assertTrue(
+            os.path.exists(os.path.join(cache_dir, 'pacman-local.idx')))
+        self.assertFalse(os.path.exists(os.path.join(cache_dir, 'pacman.idx')))
+
+
     def testBadResponsesFromAur(self):
         r = self.Auracle(['info', '503'])
         self.assertNotEqual(r.process.returncode, 0)
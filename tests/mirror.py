@@ -0,0 +1,64 @@
+#!/usr/bin/env python
+
+import auracle_test
+import json
+import os
+
+
+class TestMirror(auracle_test.TestCase):
+
+    def setUp(self):
+        super().setUp()
+
+        self.mirror = os.path.join(self.tempdir, 'mirror')
+        os.makedirs(os.path.join(self.mirror, 'info'))
+
+        fakedb = os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                              'fakeaur', 'db', 'info')
+        for pkgname in ('auracle-git', 'pkgfile-git'):
+            with open(os.path.join(fakedb, pkgname)) as f:
+                package = json.load(f)['results'][0]
+            with open(os.path.join(self.mirror, 'info',
+                                   pkgname + '.json'), 'w') as f:
+                json.dump(package, f)
+
+        os.makedirs(os.path.join(self.mirror, 'auracle-git'))
+        with open(os.path.join(self.mirror, 'auracle-git', 'PKGBUILD'),
+                  'w') as f:
+            f.write('pkgname=auracle-git\n')
+
+
+    def MirrorAuracle(self, args):
+        return self.Auracle(['--baseurl', 'file://' + self.mirror] + args)
+
+
+    def testAnswersInfoFromMirror(self):
+        r = self.MirrorAuracle(['info', 'auracle-git', 'pkgfile-git'])
+        self.assertEqual(r.process.returncode, 0)
+        self.assertIn(b'auracle-git', r.process.stdout)
+        self.assertIn(b'pkgfile-git', r.process.stdout)
+
+        # Nothing should have gone out over the network.
+        self.assertListEqual(r.request_uris, [])
+
+
+    def testMissingPackages(self):
+        r = self.MirrorAuracle(['info', 'packagenotfoundbro'])
+        self.assertNotEqual(r.process.returncode, 0)
+        self.assertListEqual(r.request_uris, [])
+
+
+    def testShowsSourceFilesFromCheckout(self):
+        r = self.MirrorAuracle(['show', 'auracle-git'])
+        self.assertEqual(r.process.returncode, 0)
+        self.assertEqual(r.process.stdout, b'pkgname=auracle-git\n')
+
+
+    def testSearchIsUnavailable(self):
+        r = self.MirrorAuracle(['search', 'aura'])
+        self.assertNotEqual(r.process.returncode, 0)
+        self.assertIn(b'local mirror', r.process.stderr)
+
+
+if __name__ == '__main__':
+    auracle_test.main()
@@ -15,7 +15,7 @@ class TestDownload(auracle_test.TestCase):
 
         # TODO: build this dynamically from the filesystem?
         self.assertCountEqual(r.request_uris, [
-            '/rpc?v=5&type=info&arg[]=auracle-git&arg[]=ocaml&arg[]=pkgfile-git'])
+            '/rpc?v=5&type=info&arg[]=auracle-git&arg[]=pkgfile-git'])
 
 
     def testOutdatedFiltersUpdatesToArgs(self):
@@ -26,6 +26,30 @@ class TestDownload(auracle_test.TestCase):
             '/rpc?v=5&type=info&arg[]=auracle-git'])
 
 
+    def testOutdatedReadsNamesFromStdin(self):
+        r = self.Auracle(['outdated', '-'],
+                         stdin=b'auracle-git\nnotinstalled\nauracle-git\n')
+        self.assertEqual(r.process.returncode, 0)
+
+        self.assertCountEqual(r.request_uris, [
+            '/rpc?v=5&type=info&arg[]=auracle-git'])
+
+
+    def testIgnorePkgMatchesAnyPattern(self):
+        # As in libalpm, any matching pattern ignores a package. A leading '!'
+        # is just part of the glob, so it can't exempt auracle-git. Setting
+        # IgnoreGroup sends the check through libalpm, which must agree.
+        for options in ('IgnorePkg = auracle-* !auracle-git',
+                        'IgnorePkg = auracle-* !auracle-git\n'
+                        'IgnoreGroup = nosuchgroup'):
+            self._WritePacmanConf(options)
+            r = self.Auracle(['outdated', '--quiet'])
+            self.assertEqual(r.process.returncode, 0)
+            self.assertListEqual(
+                    r.process.stdout.decode().strip().splitlines(),
+                    ['pkgfile-git'])
+
+
     def testExitsNonZeroWithoutUpgrades(self):
         r = self.Auracle(['outdated', '--quiet', 'ocaml'])
         self.assertEqual(r.process.returncode, 1)
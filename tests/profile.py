@@ -0,0 +1,31 @@
+#!/usr/bin/env python
+
+import auracle_test
+import os
+
+
+class TestProfile(auracle_test.TestCase):
+
+    def testWritesFoldedStacks(self):
+        profile = os.path.join(self.tempdir, 'profile')
+
+        r = self.Auracle(['--profile', profile, 'info', 'auracle-git'])
+        self.assertEqual(r.process.returncode, 0)
+        self.assertIn(b'auracle-git', r.process.stdout)
+
+        with open(profile) as f:
+            lines = f.read().splitlines()
+
+        for line in lines:
+            self.assertRegex(line, r'^auracle(;[a-z-]+)* [0-9]+$')
+
+
+    def testUnwritableProfile(self):
+        profile = os.path.join(self.tempdir, 'nonexistent', 'profile')
+
+        r = self.Auracle(['--profile', profile, 'info', 'auracle-git'])
+        self.assertIn(b'failed to write profile', r.process.stderr)
+
+
+if __name__ == '__main__':
+    auracle_test.main()
@@ -21,6 +21,25 @@ class TestRawQuery(auracle_test.TestCase):
         ])
 
 
+    def testRawInfoMergesSplitRequests(self):
+        # Enough padding to force the query into multiple requests.
+        missing = ['packagenotfoundbro{}'.format(i) for i in range(400)]
+        r = self.Auracle(['rawinfo', 'auracle-git'] + missing + ['pkgfile-git'])
+        self.assertEqual(r.process.returncode, 0)
+        self.assertGreater(len(r.request_uris), 1)
+
+        parsed = json.loads(r.process.stdout)
+        self.assertEqual(parsed['resultcount'], 2)
+        self.assertCountEqual([r['Name'] for r in parsed['results']],
+                              ['auracle-git', 'pkgfile-git'])
+
+
+    def testRawInfoFailureWritesNothing(self):
+        r = self.Auracle(['rawinfo', '503'])
+        self.assertNotEqual(r.process.returncode, 0)
+        self.assertEqual(r.process.stdout, b'')
+
+
     def testRawSearch(self):
         r = self.Auracle(['rawsearch', 'aura'])
         self.assertEqual(r.process.returncode, 0)
@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+
+import auracle_test
+import os
+
+
+class TestReplay(auracle_test.TestCase):
+
+    def Record(self, args):
+        transcript = os.path.join(self.tempdir, 'transcript')
+        r = self.Auracle(args, env={'AURACLE_RECORD': transcript})
+        self.assertEqual(r.process.returncode, 0)
+        self.assertNotEqual(r.request_uris, [])
+        return r, transcript
+
+
+    def testReplaysRecordedSession(self):
+        recorded, transcript = self.Record(['info', 'auracle-git'])
+
+        r = self.Auracle(['info', 'auracle-git'], env={
+            'AURACLE_REPLAY': transcript,
+            'AURACLE_REPLAY_LATENCY_SCALE': '0',
+        })
+        self.assertEqual(r.process.returncode, 0)
+        self.assertEqual(r.process.stdout, recorded.process.stdout)
+
+        # Nothing should have gone out over the network.
+        self.assertListEqual(r.request_uris, [])
+
+
+    def testUnrecordedRequestsFail(self):
+        _, transcript = self.Record(['info', 'auracle-git'])
+
+        r = self.Auracle(['info', 'pkgfile-git'], env={
+            'AURACLE_REPLAY': transcript,
+        })
+        self.assertNotEqual(r.process.returncode, 0)
+        self.assertIn(b'no recorded response', r.process.stderr)
+        self.assertListEqual(r.request_uris, [])
+
+
+    def testMissingTranscript(self):
+        r = self.Auracle(['info', 'auracle-git'], env={
+            'AURACLE_REPLAY': os.path.join(self.tempdir, 'nonexistent'),
+        })
+        self.assertNotEqual(r.process.returncode, 0)
+        self.assertListEqual(r.request_uris, [])
+
+
+if __name__ == '__main__':
+    auracle_test.main()
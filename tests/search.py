@@ -77,5 +77,24 @@ class TestSearch(auracle_test.TestCase):
         ])
 
 
+    def testFilteredSearch(self):
+        r = self.Auracle(['search', '--quiet', '--filter',
+                          'votes >= 100 && !outofdate', 'aura'])
+        self.assertEqual(r.process.returncode, 0)
+        self.assertListEqual(r.process.stdout.decode().splitlines(),
+                             ['aura-bin'])
+
+        r = self.Auracle(['search', '--quiet', '--filter', 'outofdate',
+                          'aura'])
+        self.assertEqual(r.process.returncode, 0)
+        self.assertListEqual(r.process.stdout.decode().splitlines(), ['aura'])
+
+
+    def testInvalidFilter(self):
+        r = self.Auracle(['search', '--filter', 'votes >', 'aura'])
+        self.assertNotEqual(r.process.returncode, 0)
+        self.assertListEqual(r.request_uris, [])
+
+
 if __name__ == '__main__':
     auracle_test.main()
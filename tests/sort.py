@@ -56,6 +56,15 @@ class SortTest(auracle_test.TestCase):
         self.assertTrue(all(v[i] >= v[i+1] for i in range(len(v) -1)))
 
 
+    def testUnsortedSearch(self):
+        r = self.Auracle(['--sort', 'none', '-q', 'search', 'aura'])
+        self.assertEqual(r.process.returncode, 0)
+
+        names = r.process.stdout.decode().splitlines()
+        self.assertGreater(len(names), 0)
+        self.assertCountEqual(names, set(names))
+
+
     def testSortByInvalidKey(self):
         r = self.Auracle(['--sort', 'nonsense', 'search', 'aura'])
         self.assertNotEqual(r.process.returncode, 0)
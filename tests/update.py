@@ -17,6 +17,11 @@ class TestDownload(auracle_test.TestCase):
         self.assertEqual(r.process.returncode, 0)
         self.assertPkgbuildExists('auracle-git')
 
+        # The outdated check already fetched everything we need, so there
+        # shouldn't be a second round trip for the same package.
+        self.assertCountEqual(r.request_uris, [
+            '/rpc?v=5&type=info&arg[]=auracle-git'])
+
 
     def testExitsNonZeroWithoutUpgrades(self):
         r = self.Auracle(['update', 'ocaml'])